@@ -0,0 +1,35 @@
+#include "simple_logger.h"
+#include <iostream>
+#include <csignal>
+
+/**
+ * @brief the writer process of shared logs, so worker processes only push their logs into the shared ring
+ * @example simple_logd worker ./Logs 5242880 100
+ */
+static std::atomic_bool s_bExit{false};
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: " << argv[0] << " <key> [directory] [file max byte] [file max count]" << std::endl;
+		return 1;
+	}
+
+	signal(SIGINT, [](int) { s_bExit = true; });
+	signal(SIGTERM, [](int) { s_bExit = true; });
+
+	const auto _dir = (argc > 2) ? argv[2] : Simple::Logger::s_kFileStorePathDefault;
+	const auto _byteMax = (argc > 3) ? std::stoull(argv[3]) : Simple::Logger::s_kFileByteDefault;
+	const auto _cntMax = (argc > 4) ? std::stoull(argv[4]) : Simple::Logger::s_kFileCntDefault;
+	E_loggerInst.ConfigShare(argv[1]);
+	E_loggerInst.ConfigFile(E_INFO, _dir, _byteMax, _cntMax);
+	E_Info("simple_logd", "started, pid ", getpid());
+	while (!s_bExit)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{200});
+	}
+	E_Info("simple_logd", "exit, pid ", getpid());
+	return 0;
+}
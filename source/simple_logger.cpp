@@ -0,0 +1,2563 @@
+#include "simple_logger.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#ifdef ANDROID
+#include <android/log.h>
+#else
+#include <iostream>
+#endif
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <limits>
+
+#if ((defined(_MSC_VER) && (_MSC_VER > 1900)) || (defined(__GNUC__) && (__GNUC__ >= 8)))
+#include <filesystem>
+#define M_HAS_std_filesystem
+#define M_filesystem  std::filesystem
+#else
+#include <experimental/filesystem>
+#define M_HAS_std_experimental_filesystem
+#define M_filesystem  std::experimental::filesystem
+#endif
+
+// io_uring write backend, define E_LOGGER_NO_IO_URING to leave it out
+#if defined(__linux__) && !defined(ANDROID) && !defined(E_LOGGER_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cerrno>
+#define M_HAS_io_uring
+#endif
+#endif
+#endif
+
+// shortest round trip floating point numbers of structured logs, printf with max_digits10 without it
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#define M_HAS_float_to_chars
+#endif
+#endif
+#endif
+#ifndef M_HAS_float_to_chars
+#include <cstdio>
+#endif
+
+// vectorized escaping of structured logs, scalar without SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define M_HAS_sse2
+#endif
+
+// multi-process shared memory queue, define E_LOGGER_NO_SHARE to leave it out
+#if !defined(_WIN32) && !defined(ANDROID) && !defined(E_LOGGER_NO_SHARE)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <cerrno>
+#include <ctime>
+#define M_HAS_share
+#endif
+
+#ifdef _WIN32
+#define E_PATH_SEPARATOR  '\\'
+#else
+#define E_PATH_SEPARATOR  '/'
+#endif
+
+namespace Simple
+{
+
+#ifdef M_HAS_io_uring
+/**
+ * @brief append only file writer on io_uring
+ * @note the memory was submitted as is, and should be kept until its pending counter went back to 0,
+ *       so the next batch was drained while the kernel was writing the previous one
+ * @note not thread safe, only used by the write file thread
+ */
+class UringWriter final
+{
+private:
+	struct Slot
+	{
+		const char *m_data = nullptr;
+		size_t m_byte = 0;
+		size_t m_done = 0;         // written byte count, for short writes
+		uint64_t m_offset = 0;     // file offset of m_data[0]
+		uint32_t *m_pending = nullptr;
+		size_t m_lineCnt = 0;      // lines dropped if the write failed
+		bool m_bInFlight = false;
+		bool m_bShort = false;     // short write, the rest should be submitted again
+	};
+
+	static constexpr auto s_kSyncTag = ~uint64_t{0};
+
+public:
+	UringWriter() = default;
+
+	~UringWriter() noexcept
+	{
+		Close();
+		Release();
+	}
+
+	UringWriter(const UringWriter &) = delete;
+
+	UringWriter &
+	operator=(const UringWriter &) = delete;
+
+	/**
+	 * @return false when io_uring was not available, e.g. old kernel, seccomp or io_uring_disabled
+	 */
+	E_NODISCARD
+	bool
+	Setup(uint32_t _depth)
+	{
+		Release();
+		m_entries = _depth + 1; // one more for fsync
+		io_uring_params _params{};
+		m_ring = static_cast<int>(syscall(__NR_io_uring_setup, m_entries, std::addressof(_params)));
+		if (m_ring < 0)
+		{
+			return false;
+		}
+		m_entries = _params.sq_entries;
+		m_sqByte = _params.sq_off.array + _params.sq_entries * sizeof(uint32_t);
+		m_cqByte = _params.cq_off.cqes + _params.cq_entries * sizeof(io_uring_cqe);
+		const auto _bSingle = (0 != (_params.features & IORING_FEAT_SINGLE_MMAP));
+		if (_bSingle)
+		{
+			m_sqByte = m_cqByte = std::max(m_sqByte, m_cqByte);
+		}
+		m_sq = Map(m_sqByte, IORING_OFF_SQ_RING);
+		m_cq = _bSingle ? m_sq : Map(m_cqByte, IORING_OFF_CQ_RING);
+		m_sqes = static_cast<io_uring_sqe *>(Map(_params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+		if (!m_sq || !m_cq || !m_sqes)
+		{
+			Release();
+			return false;
+		}
+		auto _sq = static_cast<char *>(m_sq);
+		auto _cq = static_cast<char *>(m_cq);
+		m_sqTail = reinterpret_cast<uint32_t *>(_sq + _params.sq_off.tail);
+		m_sqMask = *reinterpret_cast<uint32_t *>(_sq + _params.sq_off.ring_mask);
+		m_sqArray = reinterpret_cast<uint32_t *>(_sq + _params.sq_off.array);
+		m_cqHead = reinterpret_cast<uint32_t *>(_cq + _params.cq_off.head);
+		m_cqTail = reinterpret_cast<uint32_t *>(_cq + _params.cq_off.tail);
+		m_cqMask = *reinterpret_cast<uint32_t *>(_cq + _params.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<io_uring_cqe *>(_cq + _params.cq_off.cqes);
+		m_slots.resize(_depth);
+		return true;
+	}
+
+	E_NODISCARD inline
+	bool
+	IsOpen(const std::string &_file) const { return (m_fd >= 0) && !m_bError && (_file == m_file); }
+
+	/**
+	 * @brief a write or sync of the open file failed, it should be closed
+	 */
+	E_NODISCARD inline
+	bool
+	IsFailed() const { return (m_fd >= 0) && m_bError; }
+
+	/**
+	 * @param _lineCnt [out] count of lines whose writes failed since last call
+	 * @return true if any write or sync failed since last call
+	 */
+	E_NODISCARD
+	bool
+	TakeFailure(size_t &_lineCnt)
+	{
+		const auto _bFailed = m_bFailed;
+		_lineCnt = m_failedLineCnt;
+		m_bFailed = false;
+		m_failedLineCnt = 0;
+		return _bFailed;
+	}
+
+	/**
+	 * @brief open the file for appending, close the previous one after all of its writes were completed
+	 * @param _byte [out] current size of the file
+	 */
+	E_NODISCARD
+	bool
+	Open(const std::string &_file, size_t &_byte)
+	{
+		Close();
+		m_fd = open(_file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+		if (m_fd < 0)
+		{
+			return false;
+		}
+		struct stat _st{};
+		if (0 != fstat(m_fd, std::addressof(_st)))
+		{
+			Close();
+			return false;
+		}
+		m_file = _file;
+		m_offset = static_cast<uint64_t>(_st.st_size);
+		m_bError = false;
+		_byte = static_cast<size_t>(m_offset);
+		return true;
+	}
+
+	/**
+	 * @brief submit a write at the end of the file without waiting
+	 * @param _pending increased now, and decreased once the write was completed
+	 * @param _lineCnt lines in _data, counted as dropped if the write failed
+	 */
+	E_NODISCARD
+	bool
+	Write(const char *_data, size_t _byte, uint32_t &_pending, size_t _lineCnt)
+	{
+		if (0 == _byte)
+		{
+			return !m_bError;
+		}
+		int32_t _index = -1;
+		while ((_index < 0) && !m_bError)
+		{
+			for (size_t i = 0; i < m_slots.size(); ++i)
+			{
+				if (!m_slots[i].m_bInFlight)
+				{
+					_index = static_cast<int32_t>(i);
+					break;
+				}
+			}
+			// all slots were in flight, wait for any of them
+			if ((_index < 0) && !Reap(1))
+			{
+				return false;
+			}
+		}
+		if (m_bError)
+		{
+			return false;
+		}
+		auto &_slot = m_slots[_index];
+		_slot.m_data = _data;
+		_slot.m_byte = _byte;
+		_slot.m_done = 0;
+		_slot.m_offset = m_offset;
+		_slot.m_pending = std::addressof(_pending);
+		_slot.m_lineCnt = _lineCnt;
+		_slot.m_bInFlight = true;
+		_slot.m_bShort = false;
+		++_pending;
+		m_offset += _byte;
+		return PrepareWrite(_index) && Enter(1, 0);
+	}
+
+	/**
+	 * @brief submit a fdatasync after all previous writes without waiting
+	 */
+	E_NODISCARD
+	bool
+	Sync()
+	{
+		auto _sqe = NextSqe();
+		if (!_sqe)
+		{
+			return false;
+		}
+		_sqe->opcode = IORING_OP_FSYNC;
+		_sqe->fd = m_fd;
+		_sqe->flags = IOSQE_IO_DRAIN; // after all previous writes
+		_sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		_sqe->user_data = s_kSyncTag;
+		return Enter(1, 0);
+	}
+
+	/**
+	 * @brief collect completed writes without waiting
+	 */
+	inline
+	void
+	Poll()
+	{
+		if (m_inFlight > 0)
+		{
+			(void) Reap(0);
+		}
+	}
+
+	E_NODISCARD inline
+	bool
+	IsIdle() const { return 0 == m_inFlight; }
+
+	/**
+	 * @brief wait until all submitted writes were completed
+	 */
+	E_NODISCARD
+	bool
+	Wait()
+	{
+		while ((m_inFlight > 0) && Reap(1))
+		{
+		}
+		return !m_bError && (0 == m_inFlight);
+	}
+
+	/**
+	 * @brief wait and close the file, the pending counters of failed writes were released too
+	 */
+	void
+	Close()
+	{
+		if (m_fd < 0)
+		{
+			return;
+		}
+		(void) Wait();
+		close(m_fd);
+		m_fd = -1;
+		m_file.clear();
+		for (auto &_slot: m_slots)
+		{
+			if (_slot.m_bInFlight)
+			{
+				--*_slot.m_pending;
+				SetFailed(_slot.m_lineCnt); // not completed, or the rest of a short write was not submitted
+			}
+			_slot = Slot{};
+		}
+		m_inFlight = 0;
+	}
+
+private:
+	void *
+	Map(size_t _byte, off_t _offset) const
+	{
+		auto _p = mmap(nullptr, _byte, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, _offset);
+		return (MAP_FAILED == _p) ? nullptr : _p;
+	}
+
+	void
+	Release()
+	{
+		if (m_sqes)
+		{
+			munmap(m_sqes, m_entries * sizeof(io_uring_sqe));
+		}
+		if (m_cq && (m_cq != m_sq))
+		{
+			munmap(m_cq, m_cqByte);
+		}
+		if (m_sq)
+		{
+			munmap(m_sq, m_sqByte);
+		}
+		if (m_ring >= 0)
+		{
+			close(m_ring);
+		}
+		m_sq = m_cq = nullptr;
+		m_sqes = nullptr;
+		m_ring = -1;
+		m_slots.clear();
+	}
+
+	void
+	SetFailed(size_t _lineCnt)
+	{
+		m_bError = true;
+		m_bFailed = true;
+		m_failedLineCnt += _lineCnt;
+	}
+
+	E_NODISCARD
+	bool
+	PrepareWrite(int32_t _index)
+	{
+		auto _sqe = NextSqe();
+		if (!_sqe)
+		{
+			return false;
+		}
+		auto &_slot = m_slots[_index];
+		_sqe->opcode = IORING_OP_WRITE;
+		_sqe->fd = m_fd;
+		_sqe->off = _slot.m_offset + _slot.m_done;
+		_sqe->addr = reinterpret_cast<uint64_t>(_slot.m_data + _slot.m_done);
+		_sqe->len = static_cast<uint32_t>(_slot.m_byte - _slot.m_done);
+		_sqe->user_data = static_cast<uint64_t>(_index);
+		return true;
+	}
+
+	E_NODISCARD
+	io_uring_sqe *
+	NextSqe()
+	{
+		while ((m_inFlight >= m_entries) && !m_bError)
+		{
+			if (!Reap(1))
+			{
+				return nullptr;
+			}
+		}
+		if (m_bError)
+		{
+			return nullptr;
+		}
+		const auto _tail = *m_sqTail;
+		const auto _index = _tail & m_sqMask;
+		auto _sqe = m_sqes + _index;
+		memset(_sqe, 0, sizeof(*_sqe));
+		m_sqArray[_index] = _index;
+		__atomic_store_n(m_sqTail, _tail + 1, __ATOMIC_RELEASE);
+		++m_inFlight;
+		return _sqe;
+	}
+
+	E_NODISCARD
+	bool
+	Enter(uint32_t _submit, uint32_t _wait)
+	{
+		const auto _flags = _wait ? IORING_ENTER_GETEVENTS : 0u;
+		while (syscall(__NR_io_uring_enter, m_ring, _submit, _wait, _flags, nullptr, 0) < 0)
+		{
+			if (EINTR != errno)
+			{
+				m_bError = true;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief collect completions, wait for at least _wait of them, a short write was submitted again for its rest
+	 */
+	E_NODISCARD
+	bool
+	Reap(uint32_t _wait)
+	{
+		if (_wait && !Enter(0, _wait))
+		{
+			return false;
+		}
+		auto _head = *m_cqHead;
+		const auto _tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		for (; _head != _tail; ++_head)
+		{
+			const auto &_cqe = m_cqes[_head & m_cqMask];
+			--m_inFlight;
+			if (s_kSyncTag == _cqe.user_data)
+			{
+				if (_cqe.res < 0)
+				{
+					SetFailed(0);
+				}
+				continue;
+			}
+			auto &_slot = m_slots[static_cast<size_t>(_cqe.user_data)];
+			if (_cqe.res > 0)
+			{
+				_slot.m_done += static_cast<size_t>(_cqe.res);
+			}
+			_slot.m_bShort = (_cqe.res > 0) && (_slot.m_done < _slot.m_byte);
+			if (!_slot.m_bShort)
+			{
+				if (_cqe.res <= 0)
+				{
+					SetFailed(_slot.m_lineCnt);
+				}
+				_slot.m_bInFlight = false;
+				--*_slot.m_pending;
+			}
+		}
+		__atomic_store_n(m_cqHead, _head, __ATOMIC_RELEASE);
+
+		uint32_t _resubmit = 0;
+		for (size_t i = 0; i < m_slots.size(); ++i)
+		{
+			if (m_slots[i].m_bShort && !m_bError)
+			{
+				m_slots[i].m_bShort = false;
+				if (!PrepareWrite(static_cast<int32_t>(i)))
+				{
+					return false;
+				}
+				++_resubmit;
+			}
+		}
+		return (0 == _resubmit) || Enter(_resubmit, 0);
+	}
+
+private:
+	int m_ring = -1;
+	uint32_t m_entries = 0;
+	size_t m_sqByte = 0;
+	size_t m_cqByte = 0;
+	void *m_sq = nullptr;
+	void *m_cq = nullptr;
+	io_uring_sqe *m_sqes = nullptr;
+	uint32_t *m_sqTail = nullptr;
+	uint32_t *m_sqArray = nullptr;
+	uint32_t m_sqMask = 0;
+	uint32_t *m_cqHead = nullptr;
+	uint32_t *m_cqTail = nullptr;
+	uint32_t m_cqMask = 0;
+	io_uring_cqe *m_cqes = nullptr;
+
+	int m_fd = -1;
+	std::string m_file;
+	uint64_t m_offset = 0;  // file offset of the next write
+	bool m_bError = false;  // sticky until next Open
+	bool m_bFailed = false; // kept until TakeFailure
+	size_t m_failedLineCnt = 0;
+	uint32_t m_inFlight = 0;
+	std::vector<Slot> m_slots;
+};
+#else
+// only completes the type of Logger::m_uring, which was never created
+class UringWriter final {};
+#endif
+
+#ifdef M_HAS_share
+/**
+ * @brief byte ring in POSIX shared memory, several processes push lines and the elected writer process pops them
+ * @note the writer was elected by an exclusive flock on a lock file named by the same key as the shared memory,
+ *       not by the log directory, released once the writer exited, so another process could take over
+ * @note the mutex was robust, a process dying while holding it would not block the others
+ * @note the shared memory was never unlinked, it was reused and drained by the next writer
+ */
+class ShareRing final
+{
+private:
+	struct Header
+	{
+		uint32_t m_magic;
+		uint32_t m_headerByte;
+		pthread_mutex_t m_mutex;
+		pthread_cond_t m_condData;  // signaled after pushing
+		pthread_cond_t m_condRoom;  // signaled after popping
+		uint64_t m_capacity;
+		uint64_t m_head;            // pop position, increased only
+		uint64_t m_tail;            // push position, increased only
+		uint64_t m_dropped;         // lines dropped by producers, reset by the writer
+	};
+
+	static constexpr auto s_kMagic = uint32_t{0x534C5252}; // SLRR
+	static constexpr auto s_kWrap = ~uint32_t{0};
+	static constexpr auto s_kLenByte = sizeof(uint32_t);
+#ifdef __linux__
+	static constexpr auto s_kLockDir = "/dev/shm/"; // where shm_open placed the shared memory
+#else
+	static constexpr auto s_kLockDir = "/tmp/";
+#endif
+
+public:
+	ShareRing() = default;
+
+	~ShareRing() noexcept
+	{
+		if (m_header)
+		{
+			munmap(m_header, m_mapByte);
+		}
+		if (m_lockFd >= 0)
+		{
+			close(m_lockFd); // release the writer lock
+		}
+	}
+
+	ShareRing(const ShareRing &) = delete;
+
+	ShareRing &
+	operator=(const ShareRing &) = delete;
+
+	/**
+	 * @brief create or attach the shared memory of _name, the creator initialized it
+	 */
+	E_NODISCARD
+	bool
+	Open(const std::string &_name, size_t _capacity)
+	{
+		const auto _shm = "/simple_logger_" + _name;
+		m_lockFile = s_kLockDir + _shm.substr(1) + ".lock";
+		auto _bCreator = true;
+		auto _fd = shm_open(_shm.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if ((_fd < 0) && (EEXIST == errno))
+		{
+			_bCreator = false;
+			_fd = shm_open(_shm.c_str(), O_RDWR | O_CLOEXEC, 0600);
+		}
+		if (_fd < 0)
+		{
+			return false;
+		}
+
+		if (_bCreator)
+		{
+			m_mapByte = sizeof(Header) + _capacity;
+			if (0 != ftruncate(_fd, static_cast<off_t>(m_mapByte)))
+			{
+				close(_fd);
+				return false;
+			}
+		}
+		else
+		{
+			// wait for the creator, and use its capacity
+			struct stat _st{};
+			for (int i = 0; (i < 1000) && (0 == fstat(_fd, std::addressof(_st))) && (_st.st_size < off_t{sizeof(Header)}); ++i)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{1});
+			}
+			m_mapByte = static_cast<size_t>(_st.st_size);
+			if (m_mapByte <= sizeof(Header))
+			{
+				close(_fd);
+				return false;
+			}
+		}
+
+		auto _p = mmap(nullptr, m_mapByte, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		close(_fd);
+		if (MAP_FAILED == _p)
+		{
+			return false;
+		}
+		m_header = static_cast<Header *>(_p);
+		m_data = static_cast<char *>(_p) + sizeof(Header);
+
+		if (_bCreator)
+		{
+			pthread_mutexattr_t _ma;
+			pthread_mutexattr_init(std::addressof(_ma));
+			pthread_mutexattr_setpshared(std::addressof(_ma), PTHREAD_PROCESS_SHARED);
+			pthread_mutexattr_setrobust(std::addressof(_ma), PTHREAD_MUTEX_ROBUST);
+			pthread_mutex_init(std::addressof(m_header->m_mutex), std::addressof(_ma));
+			pthread_mutexattr_destroy(std::addressof(_ma));
+			pthread_condattr_t _ca;
+			pthread_condattr_init(std::addressof(_ca));
+			pthread_condattr_setpshared(std::addressof(_ca), PTHREAD_PROCESS_SHARED);
+			pthread_condattr_setclock(std::addressof(_ca), CLOCK_MONOTONIC);
+			pthread_cond_init(std::addressof(m_header->m_condData), std::addressof(_ca));
+			pthread_cond_init(std::addressof(m_header->m_condRoom), std::addressof(_ca));
+			pthread_condattr_destroy(std::addressof(_ca));
+			m_header->m_capacity = _capacity;
+			m_header->m_head = m_header->m_tail = m_header->m_dropped = 0;
+			m_header->m_headerByte = sizeof(Header);
+			__atomic_store_n(std::addressof(m_header->m_magic), s_kMagic, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			for (int i = 0; (i < 1000) && (s_kMagic != __atomic_load_n(std::addressof(m_header->m_magic), __ATOMIC_ACQUIRE)); ++i)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{1});
+			}
+			if ((s_kMagic != __atomic_load_n(std::addressof(m_header->m_magic), __ATOMIC_ACQUIRE))
+				|| (sizeof(Header) != m_header->m_headerByte)
+				|| (sizeof(Header) + m_header->m_capacity != m_mapByte))
+			{
+				munmap(m_header, m_mapByte);
+				m_header = nullptr;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief try to be the writer without waiting, the lock was kept until the process exited
+	 */
+	E_NODISCARD
+	bool
+	TryLockWriter()
+	{
+		if (m_lockFd < 0)
+		{
+			m_lockFd = open(m_lockFile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		}
+		m_bWriter = (m_lockFd >= 0) && (0 == flock(m_lockFd, LOCK_EX | LOCK_NB));
+		return m_bWriter;
+	}
+
+	E_NODISCARD inline
+	bool
+	IsWriter() const { return m_bWriter; }
+
+	E_NODISCARD
+	bool
+	Lock()
+	{
+		const auto _ret = pthread_mutex_lock(std::addressof(m_header->m_mutex));
+		if (EOWNERDEAD == _ret)
+		{
+			pthread_mutex_consistent(std::addressof(m_header->m_mutex));
+			return true;
+		}
+		return 0 == _ret;
+	}
+
+	inline
+	void
+	Unlock() { pthread_mutex_unlock(std::addressof(m_header->m_mutex)); }
+
+	/**
+	 * @brief the push position after the lines pushed so far, called locked
+	 */
+	E_NODISCARD inline
+	uint64_t
+	TailLocked() const { return m_header->m_tail; }
+
+	/**
+	 * @brief whether the writer popped all lines pushed before _tail
+	 */
+	E_NODISCARD
+	bool
+	IsPopped(uint64_t _tail)
+	{
+		if (!Lock())
+		{
+			return false;
+		}
+		const auto _bPopped = m_header->m_head >= _tail;
+		Unlock();
+		return _bPopped;
+	}
+
+	/**
+	 * @brief the longest line could be pushed, half of the ring
+	 */
+	E_NODISCARD inline
+	size_t
+	LineByteMax() const { return static_cast<size_t>(m_header->m_capacity / 2 - s_kLenByte); }
+
+	/**
+	 * @brief push a line, wait for room until _deadline, called locked
+	 * @note the line should not be longer than LineByteMax
+	 */
+	E_NODISCARD
+	bool
+	PushLocked(std::string_view _line, const timespec &_deadline)
+	{
+		assert(_line.size() <= LineByteMax());
+		const auto _cap = m_header->m_capacity;
+		const uint64_t _byte = _line.size();
+		for (;;)
+		{
+			const auto _offset = m_header->m_tail % _cap;
+			const auto _skip = (_cap - _offset < s_kLenByte + _byte) ? (_cap - _offset) : 0;
+			if (_cap - (m_header->m_tail - m_header->m_head) >= _skip + s_kLenByte + _byte)
+			{
+				if (_skip >= s_kLenByte)
+				{
+					memcpy(m_data + _offset, std::addressof(s_kWrap), s_kLenByte);
+				}
+				m_header->m_tail += _skip;
+				const auto _len = static_cast<uint32_t>(_byte);
+				memcpy(m_data + m_header->m_tail % _cap, std::addressof(_len), s_kLenByte);
+				memcpy(m_data + m_header->m_tail % _cap + s_kLenByte, _line.data(), _byte);
+				m_header->m_tail += s_kLenByte + _byte;
+				return true;
+			}
+			if (!WaitLocked(std::addressof(m_header->m_condRoom), _deadline))
+			{
+				return false;
+			}
+		}
+	}
+
+	/**
+	 * @brief count the lines failed to push, reported by the writer, called locked
+	 */
+	inline
+	void
+	DropLocked(uint64_t _cnt) { m_header->m_dropped += _cnt; }
+
+	/**
+	 * @brief wake the writer after pushing, called locked
+	 */
+	inline
+	void
+	NotifyData() { pthread_cond_signal(std::addressof(m_header->m_condData)); }
+
+	/**
+	 * @brief wait for lines until _deadline, called locked
+	 */
+	E_NODISCARD inline
+	bool
+	WaitDataLocked(const timespec &_deadline)
+	{
+		return (m_header->m_head != m_header->m_tail) || WaitLocked(std::addressof(m_header->m_condData), _deadline);
+	}
+
+	/**
+	 * @brief pop all lines to _fn, called locked
+	 * @return the dropped line count since the last pop
+	 */
+	template <typename Fn>
+	E_NODISCARD
+	uint64_t
+	PopLocked(Fn &&_fn)
+	{
+		const auto _cap = m_header->m_capacity;
+		while (m_header->m_head != m_header->m_tail)
+		{
+			const auto _offset = m_header->m_head % _cap;
+			uint32_t _len = s_kWrap;
+			if (_cap - _offset >= s_kLenByte)
+			{
+				memcpy(std::addressof(_len), m_data + _offset, s_kLenByte);
+			}
+			if (s_kWrap == _len)
+			{
+				m_header->m_head += _cap - _offset;
+				continue;
+			}
+			_fn(std::string_view{m_data + _offset + s_kLenByte, _len});
+			m_header->m_head += s_kLenByte + _len;
+		}
+		pthread_cond_broadcast(std::addressof(m_header->m_condRoom));
+		const auto _dropped = m_header->m_dropped;
+		m_header->m_dropped = 0;
+		return _dropped;
+	}
+
+	static inline
+	timespec
+	Deadline(std::chrono::milliseconds _wait)
+	{
+		timespec _ts{};
+		clock_gettime(CLOCK_MONOTONIC, std::addressof(_ts));
+		const auto _ns = static_cast<int64_t>(_ts.tv_nsec) + std::chrono::nanoseconds{_wait}.count();
+		_ts.tv_sec += static_cast<time_t>(_ns / 1000000000);
+		_ts.tv_nsec = static_cast<long>(_ns % 1000000000);
+		return _ts;
+	}
+
+private:
+	E_NODISCARD
+	bool
+	WaitLocked(pthread_cond_t *_cond, const timespec &_deadline)
+	{
+		const auto _ret = pthread_cond_timedwait(_cond, std::addressof(m_header->m_mutex), std::addressof(_deadline));
+		if (EOWNERDEAD == _ret)
+		{
+			pthread_mutex_consistent(std::addressof(m_header->m_mutex));
+		}
+		return ETIMEDOUT != _ret;
+	}
+
+private:
+	Header *m_header = nullptr;
+	char *m_data = nullptr;
+	size_t m_mapByte = 0;
+	std::string m_lockFile;
+	int m_lockFd = -1;
+	bool m_bWriter = false;
+};
+#else
+// only completes the type of Logger::m_share, which was never created
+class ShareRing final {};
+#endif
+
+/**
+ * @brief the first byte should be escaped in a json string or a quoted logfmt value: '"', '\\' and control bytes,
+ *        16 bytes a time with SSE2
+ * @param bBare also stop at ' ' and '=', which made a logfmt value quoted
+ */
+template <bool bBare = false>
+E_NODISCARD inline
+const char *
+FindEscape(const char *_p, const char *_end)
+{
+#ifdef M_HAS_sse2
+	const auto _quote = _mm_set1_epi8('"');
+	const auto _slash = _mm_set1_epi8('\\');
+	const auto _equal = _mm_set1_epi8('=');
+	const auto _ctrl = _mm_set1_epi8(bBare ? ' ' : 0x1F);
+	for (; _end - _p >= 16; _p += 16)
+	{
+		const auto _v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_p));
+		auto _hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(_v, _quote), _mm_cmpeq_epi8(_v, _slash)),
+								 _mm_cmpeq_epi8(_mm_min_epu8(_v, _ctrl), _v)); // unsigned _v <= _ctrl
+		if (bBare)
+		{
+			_hit = _mm_or_si128(_hit, _mm_cmpeq_epi8(_v, _equal));
+		}
+		const auto _mask = static_cast<uint32_t>(_mm_movemask_epi8(_hit));
+		if (0 != _mask)
+		{
+#ifdef _MSC_VER
+			unsigned long _index = 0;
+			_BitScanForward(std::addressof(_index), _mask);
+			return _p + _index;
+#else
+			return _p + __builtin_ctz(_mask);
+#endif
+		}
+	}
+#endif
+	for (; _p < _end; ++_p)
+	{
+		const auto _c = static_cast<unsigned char>(*_p);
+		if (('"' == _c) || ('\\' == _c) || (_c <= (bBare ? ' ' : 0x1F)) || (bBare && ('=' == _c)))
+		{
+			break;
+		}
+	}
+	return _p;
+}
+
+/**
+ * @brief write _s escaped as the content of a json string, also used by quoted logfmt values
+ */
+void
+WriteEscaped(std::ostream &_os, std::string_view _s)
+{
+	static constexpr char s_kHex[] = "0123456789abcdef";
+	auto _buf = _os.rdbuf();
+	auto _p = _s.data();
+	const auto _end = _p + _s.size();
+	while (_p < _end)
+	{
+		const auto _hit = FindEscape(_p, _end);
+		_buf->sputn(_p, _hit - _p);
+		if (_hit == _end)
+		{
+			break;
+		}
+		switch (*_hit)
+		{
+			case '"': _buf->sputn("\\\"", 2); break;
+			case '\\': _buf->sputn("\\\\", 2); break;
+			case '\n': _buf->sputn("\\n", 2); break;
+			case '\r': _buf->sputn("\\r", 2); break;
+			case '\t': _buf->sputn("\\t", 2); break;
+			default:
+			{
+				const auto _c = static_cast<unsigned char>(*_hit);
+				const char _u[] = {'\\', 'u', '0', '0', s_kHex[_c >> 4], s_kHex[_c & 0xF]};
+				_buf->sputn(_u, sizeof(_u));
+				break;
+			}
+		}
+		_p = _hit + 1;
+	}
+}
+
+/**
+ * @brief write a finite floating point number losslessly
+ */
+template <typename T>
+inline
+void
+WriteFloat(std::ostream &_os, T _value)
+{
+	char _buf[64];
+#ifdef M_HAS_float_to_chars
+	const auto _n = std::to_chars(_buf, _buf + sizeof(_buf), _value).ptr - _buf;
+#else
+	const auto _n = snprintf(_buf, sizeof(_buf), "%.*Lg", std::numeric_limits<T>::max_digits10,
+							 static_cast<long double>(_value));
+#endif
+	_os.rdbuf()->sputn(_buf, static_cast<std::streamsize>(_n));
+}
+
+Logger &
+Logger::Inst()
+{
+	static Logger _inst;
+	return _inst;
+}
+
+Logger::Logger() noexcept
+		: m_strLevel(new (char const *[Logger::eCnt]){"Debug", "Info", "Warn", "Error"}),
+		m_bAlwaysMarkSourceCodePosition(false),
+		m_bLogStd(false), m_bColorStd(false), m_levelStd(E_INFO), m_stdColor(nullptr),
+		m_bLogFile(false), m_bWriteThreadAlive(false), m_levelFile(E_INFO), m_writeErrorCnt(0),
+		m_dropCnt(0), m_dropCntFlush(0),
+		m_byteMax(Logger::s_kFileByteDefault), m_cntMax(Logger::s_kFileCntDefault), m_bStop(false),
+		m_bScanBackground(false), m_stopDeadline(Logger::s_kStopDeadlineDefault),
+		m_seqQueued(0), m_seqWritten(0), m_seqFlush(0),
+		m_poolBlockCnt(0), m_stream(std::addressof(m_streamBuf)),
+		m_outputFormat(Logger::eFormatText), m_valueStream(std::addressof(m_valueBuf)),
+		m_wakeMode(Logger::eWakeNotify), m_batchInterval(Logger::s_kBatchIntervalDefault),
+		m_writeThreadCpu(-1), m_writeThreadPriority(0), m_bPending(false), m_bWriteThreadParked(false),
+		m_bShare(false), m_shareByte(Logger::s_kShareByteDefault),
+		m_bShareStop(false), m_sharePushed(0),
+		m_bUring(false), m_bUringDataSync(false)
+{
+#ifdef M_HAS_share
+	m_share = std::make_unique<ShareRing>();
+#endif
+	m_ofs = std::make_unique<std::ofstream>();
+#ifdef M_HAS_io_uring
+	m_uring = std::make_unique<UringWriter>();
+#endif
+}
+
+Logger::~Logger() noexcept
+{
+	StopFileLog();
+	delete[] m_stdColor;
+	delete[] m_strLevel;
+}
+
+void
+#ifdef _WIN32
+Logger::ConfigStd(uint32_t _recordLevel, bool _useColor, const WORD(&_color)[Logger::eCnt])
+#else
+Logger::ConfigStd(uint32_t _recordLevel, bool _useColor, char const *(&_color)[Logger::eCnt])
+#endif
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogStd); // should not call twice
+	if (m_bLogStd)
+	{
+		return;
+	}
+	m_bLogStd = true;
+	m_levelStd = (_recordLevel > E_ERROR) ? E_ERROR : _recordLevel;
+	m_bColorStd = _useColor;
+	if (m_bColorStd)
+	{
+#ifdef _WIN32
+		m_stdColor = new WORD[Logger::eCnt]{_color[E_DEBUG], _color[E_INFO], _color[E_WARN], _color[E_ERROR]};
+#else
+		m_stdColor = new char const *[Logger::eCnt];
+		m_stdColor[E_DEBUG] = (nullptr == _color[E_DEBUG]) ? E_STD_COLOR_WHITE : _color[E_DEBUG];
+		m_stdColor[E_INFO] = (nullptr == _color[E_INFO]) ? E_STD_COLOR_GREEN : _color[E_INFO];
+		m_stdColor[E_WARN] = (nullptr == _color[E_WARN]) ? E_STD_COLOR_YELLOW : _color[E_WARN];
+		m_stdColor[E_ERROR] = (nullptr == _color[E_ERROR]) ? E_STD_COLOR_RED : _color[E_ERROR];
+#endif
+	}
+}
+
+void
+Logger::ConfigFile(uint32_t _recordLevel, const std::string &_storeDirectory,
+				   size_t _byteMax, size_t _cntMax)
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should not call twice
+	if (m_bLogFile)
+	{
+		return;
+	}
+	m_levelFile = (_recordLevel > E_ERROR) ? E_ERROR : _recordLevel;
+	m_strDir = EnsurePath(_storeDirectory);
+	m_strName = (m_bShare && !m_shareKey.empty()) ? m_shareKey : GetExeName();
+#define E_ENSURE_RANGE(_v, _max, _min)  (((_v) > (_max)) ? (_max) : (((_v) < (_min)) ? (_min) : (_v)))
+	m_byteMax = E_ENSURE_RANGE(_byteMax, Logger::s_kFileByteAllowMax, Logger::s_kFileByteAllowMin);
+	m_cntMax = E_ENSURE_RANGE(_cntMax, Logger::s_kFileCntAllowMax, Logger::s_kFileCntAllowMin);
+#undef E_ENSURE_RANGE
+	M_StdLog(E_LOG_POS, E_INFO, "log files were stored in (", m_strDir, "), prefix (", m_strName,
+			 "), max size (", GetByteSizeString(m_byteMax, 1), "), max count (", m_cntMax, ")");
+#ifdef M_HAS_share
+	OpenShare();
+#endif
+	if (!m_bScanBackground)
+	{
+		ScanLogFiles();
+	}
+	m_bLogFile = true;
+	m_bStop = false;
+	// start the write file thread
+	m_ptrWriteThread = std::make_shared<std::thread>(&Logger::WriteThread, this);
+#ifdef M_HAS_share
+	if (m_bShare && m_share->IsWriter())
+	{
+		m_ptrShareThread = std::make_shared<std::thread>(&Logger::ShareThread, this);
+	}
+#endif
+	// wait for the write file thread being ready
+	m_cond.wait(_sl, [this]() { return m_bWriteThreadAlive || m_bStop; });
+}
+
+void
+Logger::ConfigWriteThread(uint32_t _wakeMode,
+						  std::chrono::microseconds _batchInterval,
+						  int32_t _cpu, int32_t _priority)
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should be called before ConfigFile
+	if (m_bLogFile)
+	{
+		return;
+	}
+	m_wakeMode = (_wakeMode < Logger::eWakeCnt) ? _wakeMode : Logger::eWakeNotify;
+	m_batchInterval = (_batchInterval.count() > 0) ? _batchInterval : Logger::s_kBatchIntervalDefault;
+#if defined(_WIN32)
+	static constexpr auto _cpuMax = static_cast<int32_t>(sizeof(DWORD_PTR) * 8); // bits of the affinity mask
+#elif defined(__linux__)
+	static constexpr auto _cpuMax = static_cast<int32_t>(CPU_SETSIZE);
+#else
+	static constexpr auto _cpuMax = std::numeric_limits<int32_t>::max(); // not pinned, warned by PlaceWriteThread
+#endif
+	if ((_cpu < -1) || (_cpu >= _cpuMax))
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "write file thread cpu (", _cpu, ") out of range [0, ", _cpuMax, "), not pinned");
+		_cpu = -1;
+	}
+	m_writeThreadCpu = _cpu;
+	m_writeThreadPriority = _priority;
+}
+
+void
+Logger::ConfigUring(uint32_t _depth, bool _bDataSync)
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should be called before ConfigFile
+	if (m_bLogFile)
+	{
+		return;
+	}
+#ifdef M_HAS_io_uring
+	_depth = (_depth < 1) ? 1 : _depth;
+	m_bUring = m_uring->Setup(_depth);
+	m_bUringDataSync = _bDataSync;
+	if (m_bUring)
+	{
+		M_StdLog(E_LOG_POS, E_INFO, "write log files through io_uring, depth (", _depth, "), data sync (",
+				 _bDataSync, ")");
+		return;
+	}
+#else
+	(void) _depth;
+	(void) _bDataSync;
+#endif
+	M_StdLog(E_LOG_POS, E_WARN, "io_uring was not available, write log files through std::ofstream");
+}
+
+void
+Logger::ConfigShare(const std::string &_key, size_t _byte)
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should be called before ConfigFile
+	if (m_bLogFile)
+	{
+		return;
+	}
+#ifdef M_HAS_share
+	m_bShare = true;
+	m_shareKey = _key;
+	m_shareByte = (_byte < Logger::s_kBlockByte * 2) ? (Logger::s_kBlockByte * 2) : _byte;
+#else
+	(void) _key;
+	(void) _byte;
+	M_StdLog(E_LOG_POS, E_WARN, "shared logs were not supported, each process writes its own log files");
+#endif
+}
+
+void
+Logger::ConfigOutputFormat(uint32_t _format)
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should be called before ConfigFile
+	if (m_bLogFile)
+	{
+		return;
+	}
+	m_outputFormat = (_format < Logger::eFormatCnt) ? _format : Logger::eFormatText;
+}
+
+void
+Logger::ConfigBackgroundRetentionScan()
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bLogFile); // should be called before ConfigFile
+	if (m_bLogFile)
+	{
+		return;
+	}
+	m_bScanBackground = true;
+}
+
+void
+Logger::ConfigStopDeadline(std::chrono::milliseconds _deadline)
+{
+	SafeLock _sl(m_mutex);
+	m_stopDeadline = (_deadline.count() > 0) ? _deadline : std::chrono::milliseconds{0};
+}
+
+bool
+Logger::Flush(std::chrono::milliseconds _timeout)
+{
+	SafeLock _sl(m_mutex);
+	const auto _target = m_seqQueued;
+	if (m_seqWritten >= _target)
+	{
+		const auto _dropCnt = m_dropCnt.load(std::memory_order_acquire);
+		const auto _bDropped = (_dropCnt != m_dropCntFlush);
+		m_dropCntFlush = _dropCnt;
+		return !_bDropped;
+	}
+	if (m_seqFlush.load(std::memory_order_relaxed) < _target)
+	{
+		m_seqFlush.store(_target, std::memory_order_release);
+	}
+	// wake the write file thread of any mode
+	m_bPending.store(true, std::memory_order_release);
+	m_cond.notify_all();
+	const auto _bWritten = m_condFlush.wait_for(_sl, _timeout, [this, _target]() { return m_seqWritten >= _target; });
+	const auto _dropCnt = m_dropCnt.load(std::memory_order_acquire);
+	const auto _bDropped = (_dropCnt != m_dropCntFlush);
+	m_dropCntFlush = _dropCnt;
+	return _bWritten && !_bDropped;
+}
+
+void
+Logger::ConfigAlwaysMarkSourceCodePosition()
+{
+	SafeLock _sl(m_mutex);
+	assert(!m_bAlwaysMarkSourceCodePosition); // should not call twice
+	m_bAlwaysMarkSourceCodePosition = true;
+}
+
+void
+Logger::StopFileLog()
+{
+	ThreadPtr _t;
+	{
+		SafeLock _sl(m_mutex);
+		m_stopTime = std::chrono::steady_clock::now() + m_stopDeadline;
+	}
+#ifdef M_HAS_share
+	// stop moving shared logs first, so they were all queued before the write file thread stopped
+	{
+		SafeLock _sl(m_mutex);
+		m_bShareStop = true;
+		_t.swap(m_ptrShareThread);
+	}
+	if (_t && m_share->Lock())
+	{
+		m_share->NotifyData(); // wake ShareThread now
+		m_share->Unlock();
+	}
+	if (_t && _t->joinable())
+	{
+		_t->join();
+	}
+	_t.reset();
+#endif
+	{
+		SafeLock _sl(m_mutex);
+		m_bLogFile = false;
+		m_bStop = true;
+		m_cond.notify_all();
+		_t.swap(m_ptrWriteThread);
+	}
+
+	if (_t)
+	{
+		m_cond.notify_all();
+		if (_t->joinable())
+		{
+			_t->join();
+		}
+	}
+}
+
+void
+Logger::M_FormatHead(std::ostream &_os, uint32_t _format, uint32_t _level, const char *__restrict _trace)
+{
+	assert(_level < Logger::eCnt);
+	const auto _bTrace = _trace && ('\0' != _trace[0]);
+	const auto _scope = _trace ? nullptr : TraceScope::Current();
+	if (Logger::eFormatJson == _format)
+	{
+		_os << R"({"time":")" << GetTimestampForLogContent() << R"(","level":")" << m_strLevel[_level] << '"';
+		if (_scope)
+		{
+			_os << _scope->Render(*this, _format);
+		}
+		else if (_bTrace)
+		{
+			_os << R"(,"trace":")";
+			WriteEscaped(_os, _trace);
+			_os << '"';
+		}
+		_os << R"(,"msg":")";
+	}
+	else if (Logger::eFormatLogfmt == _format)
+	{
+		_os << "time=\"" << GetTimestampForLogContent() << "\" level=" << m_strLevel[_level];
+		if (_scope)
+		{
+			_os << _scope->Render(*this, _format);
+		}
+		else if (_bTrace)
+		{
+			_os << " trace=";
+			M_FormatString(_os, _format, _trace);
+		}
+		_os << " msg=\"";
+	}
+	else
+	{
+		_os << GetTimestampForLogContent() << " [" << m_strLevel[_level] << "] ";
+		if (_scope)
+		{
+			_os << _scope->Render(*this, _format);
+		}
+		else if (_bTrace)
+		{
+			_os << "trace=" << _trace << " | ";
+		}
+	}
+}
+
+void
+Logger::M_FormatString(std::ostream &_os, uint32_t _format, std::string_view _s)
+{
+	if ((Logger::eFormatLogfmt == _format) && !_s.empty()
+		&& (FindEscape<true>(_s.data(), _s.data() + _s.size()) == _s.data() + _s.size()))
+	{
+		_os.rdbuf()->sputn(_s.data(), static_cast<std::streamsize>(_s.size()));
+		return;
+	}
+	_os << '"';
+	WriteEscaped(_os, _s);
+	_os << '"';
+}
+
+void
+Logger::M_FormatKey(std::ostream &_os, std::string_view _key)
+{
+	if (_key.empty())
+	{
+		_os << '_';
+		return;
+	}
+	auto _p = _key.data();
+	const auto _end = _p + _key.size();
+	while (_p < _end)
+	{
+		const auto _hit = FindEscape<true>(_p, _end);
+		_os.rdbuf()->sputn(_p, _hit - _p);
+		if (_hit == _end)
+		{
+			break;
+		}
+		_os << '_';
+		_p = _hit + 1;
+	}
+}
+
+void
+Logger::M_FormatFloat(std::ostream &_os, float _value)
+{ WriteFloat(_os, _value); }
+
+void
+Logger::M_FormatFloat(std::ostream &_os, double _value)
+{ WriteFloat(_os, _value); }
+
+void
+Logger::M_FormatFloat(std::ostream &_os, long double _value)
+{ WriteFloat(_os, _value); }
+
+void
+Logger::M_FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+					 uint32_t _level, const char *__restrict _trace, std::string_view _payload, std::string *_owned)
+{
+	const auto _bDiy = (nullptr == _file);
+	const auto _bFile = _bDiy ? (m_bLogFile && m_bWriteThreadAlive) : NeedRecordFile(_level);
+	const auto _bStd = _bDiy ? m_bLogStd : NeedRecordStd(_level);
+	if (!_bFile && !_bStd)
+	{
+		return;
+	}
+
+	SafeLock _sl(m_mutex);
+	auto &_os = BeginLine();
+	const auto _bText = (Logger::eFormatText == m_outputFormat);
+	if (!_bDiy || !_bText)
+	{
+		M_FormatHead(_os, m_outputFormat, _level, _bDiy ? "" : _trace);
+	}
+	const auto _headByte = m_streamBuf.Size();
+	if (!_bDiy || !_bText)
+	{
+		M_FormatTail(_os, m_outputFormat, _file, _line, _func, _level);
+	}
+	if (!_bText)
+	{
+		WriteEscaped(BeginValue(), _payload);
+		_payload = m_valueBuf.View();
+		_owned = nullptr;
+	}
+	const auto _head = m_streamBuf.View().substr(0, _headByte);
+	const auto _tail = m_streamBuf.View().substr(_headByte);
+	if (_bStd)
+	{
+		PrintStdLog(std::string{_head}.append(_payload).append(_tail), _level);
+	}
+	if (!_bFile)
+	{
+		return;
+	}
+	if (_owned && (_payload.size() > Logger::s_kRecordInlineMax))
+	{
+		auto _block = new LogBlock;
+		_block->m_record.m_head = _head;
+		_block->m_record.m_payload = std::move(*_owned);
+		_block->m_record.m_tail = _tail;
+		m_queueLog.PushBack(_block);
+	}
+	else
+	{
+		PushLine(_head, _payload, _tail);
+	}
+	NotifyWriteThread();
+}
+
+Logger::LogBlock *
+Logger::AcquireBlock()
+{
+	if (!m_poolBlock.Empty())
+	{
+		--m_poolBlockCnt;
+		return m_poolBlock.PopFront();
+	}
+	auto _block = new LogBlock;
+	_block->m_data.reset(new char[Logger::s_kBlockByte]);
+	_block->m_ends.reserve(Logger::s_kBlockByte / 64);
+	return _block;
+}
+
+void
+Logger::RecycleBlocks(LogQueue &_blocks)
+{
+	LogQueue _pending;
+	while (!_blocks.Empty())
+	{
+		auto _block = _blocks.PopFront();
+		if (_block->m_pending)
+		{
+			_pending.PushBack(_block);
+		}
+		else if (_block->IsRecord() || (m_poolBlockCnt >= Logger::s_kBlockPoolMax))
+		{
+			delete _block;
+		}
+		else
+		{
+			_block->m_used = _block->m_written = _block->m_writtenCnt = 0;
+			_block->m_ends.clear();
+			m_poolBlock.PushBack(_block);
+			++m_poolBlockCnt;
+		}
+	}
+	_blocks.Swap(_pending);
+}
+
+std::string
+Logger::MakeLogFileName()
+{
+	return Format(m_strDir, E_PATH_SEPARATOR, m_strName, '_', GetTimestampForLogFileName(), ".log");
+}
+
+void
+Logger::WriteThread()
+{
+	assert(m_bLogFile);
+	PlaceWriteThread();
+	{
+		SafeLock _sl(m_mutex);
+		m_bWriteThreadAlive = true;
+	}
+	m_cond.notify_all(); // ConfigFile was waiting
+	if (m_bScanBackground)
+	{
+		ScanLogFiles();
+	}
+	auto _file = MakeLogFileName();
+	size_t _byte = 0;
+	LogQueue _logs;
+	uint64_t _seq = 0; // m_seqQueued of the logs drained
+	while (!m_bStop)
+	{
+		PollWritingFile();
+		if (IsFlushWaiting())
+		{
+			SyncWritingFile(); // Flush waits for the writes in flight too
+		}
+		{
+			SafeLock _sl(m_mutex);
+			RecycleBlocks(m_writtenBlocks);
+			CompleteFlush(_seq);
+			if (m_bStop)
+			{
+				break;
+			}
+			WaitLogs(_sl);
+			if (m_bStop)
+			{
+				break; // the logs left were written by the final drain, bounded by the stop deadline
+			}
+			m_bPending.store(false, std::memory_order_relaxed);
+			_seq = m_seqQueued;
+			if (!m_queueLog.Empty())
+			{
+				_logs.Swap(m_queueLog); // get all logs in queue
+			}
+		}
+
+		WriteBatch(_logs, _file, _byte);
+#ifdef M_HAS_share
+		(void) TryTakeOverShare(_file, _byte);
+#endif
+	}
+
+	m_bWriteThreadAlive = false;
+	// write final logs
+	{
+		SafeLock _sl(m_mutex);
+		if (!m_queueLog.Empty())
+		{
+			_logs.Swap(m_queueLog); // get all logs in queue
+		}
+	}
+
+	WriteFinalLogs(_logs, _file, _byte);
+#ifdef M_HAS_share
+	// the writer process may have exited, take over to write the lines left in the shared ring,
+	// or they were already queued by a takeover while pushing the final logs,
+	// otherwise wait for the writer to pop the lines of this process, it may be exiting after its last pop
+	while (!TryTakeOverShare(_file, _byte, true) && IsShareProducer() && !m_share->IsPopped(m_sharePushed)
+		   && (std::chrono::steady_clock::now() < m_stopTime))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	}
+	{
+		SafeLock _sl(m_mutex);
+		_logs.Swap(m_queueLog);
+	}
+	WriteFinalLogs(_logs, _file, _byte);
+#endif
+	CloseWritingFile();
+	{
+		SafeLock _sl(m_mutex);
+		RecycleBlocks(m_writtenBlocks);
+		m_seqWritten = m_seqQueued; // nothing would be written any more, release Flush
+	}
+	m_condFlush.notify_all();
+}
+
+void
+Logger::WriteFinalLogs(LogQueue &_logs, std::string &_file, size_t &_byte)
+{
+	static constexpr auto _chunkBlockCnt = size_t{16};
+	LogQueue _chunk;
+	while (!_logs.Empty() && (std::chrono::steady_clock::now() < m_stopTime))
+	{
+		for (size_t i = 0; (i < _chunkBlockCnt) && !_logs.Empty(); ++i)
+		{
+			_chunk.PushBack(_logs.PopFront());
+		}
+		WriteBatch(_chunk, _file, _byte);
+	}
+	if (!_logs.Empty())
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "stop deadline passed, drop count ", _logs.Count());
+		DropLogs(_logs);
+	}
+}
+
+void
+Logger::CompleteFlush(uint64_t _seq)
+{
+	if ((_seq <= m_seqWritten) || !IsWritingFileIdle())
+	{
+		return;
+	}
+	const auto _bWaiting = IsFlushWaiting();
+	m_seqWritten = _seq;
+	if (_bWaiting)
+	{
+		m_condFlush.notify_all();
+	}
+}
+
+void
+Logger::WriteBatch(LogQueue &_logs, std::string &_file, size_t &_byte)
+{
+	if (_logs.Empty())
+	{
+		return;
+	}
+#ifdef M_HAS_share
+	if (IsShareProducer() && ShareLogs(_logs, _file, _byte))
+	{
+		return;
+	}
+#endif
+	m_writeErrorCnt = 0;
+	if (!WriteLogs(_logs, _file, _byte) || !_logs.Empty())
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "wrote log file errors, drop count ", _logs.Count());
+		DropLogs(_logs);
+	}
+}
+
+#ifdef M_HAS_share
+bool
+Logger::IsShareProducer() const
+{ return m_bShare && !m_share->IsWriter(); }
+
+void
+Logger::OpenShare()
+{
+	if (!m_bShare)
+	{
+		return;
+	}
+	if (!m_share->Open(m_strName, m_shareByte))
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "open shared logs (", m_strName, ") failed, write own log files");
+		m_bShare = false;
+		return;
+	}
+	const auto _bWriter = m_share->TryLockWriter();
+	M_StdLog(E_LOG_POS, E_INFO, "shared logs (", m_strName, ") opened, this process was the ",
+			 _bWriter ? "writer" : "producer");
+}
+
+bool
+Logger::ShareLogs(LogQueue &_logs, std::string &_file, size_t &_byte)
+{
+	static constexpr auto _slice = std::chrono::milliseconds{200}; // as often as TryTakeOverShare tried
+	uint64_t _dropped = 0;
+	uint64_t _longCnt = 0; // dropped as they would never fit in the ring
+	auto _bLocked = m_share->Lock();
+	// wait for room 1s at most, and not after the stop deadline
+	auto _end = std::chrono::steady_clock::now() + std::chrono::milliseconds{1000};
+	if (m_bStop)
+	{
+		_end = std::min(_end, m_stopTime);
+	}
+	auto _ok = _bLocked;
+	while (!_logs.Empty())
+	{
+		const auto _block = _logs.Front();
+		std::string_view _line;
+		if (_block->IsRecord())
+		{
+			const auto &_record = _block->m_record;
+			_line = m_shareLine.assign(_record.m_head).append(_record.m_payload).append(_record.m_tail);
+		}
+		else
+		{
+			_line = {_block->m_data.get() + _block->m_written,
+					 _block->m_ends[_block->m_writtenCnt] - _block->m_written - 1};
+		}
+		if (_line.size() > m_share->LineByteMax())
+		{
+			++_longCnt;
+			ConsumeLines(_logs, _block->IsRecord() ? _block->m_record.Size() : (_line.size() + 1), 1);
+			continue;
+		}
+		// wait in slices, the writer may have exited with the ring full, and all producers waited here for room
+		while (_ok)
+		{
+			const auto _left = std::chrono::duration_cast<std::chrono::milliseconds>(
+				_end - std::chrono::steady_clock::now());
+			if (m_share->PushLocked(_line, ShareRing::Deadline(std::max(std::chrono::milliseconds{0},
+																		std::min(_left, _slice)))))
+			{
+				break;
+			}
+			if (_left <= _slice)
+			{
+				_ok = false;
+				break;
+			}
+			m_share->Unlock();
+			if (TryTakeOverShare(_file, _byte))
+			{
+				return false;
+			}
+			_ok = _bLocked = m_share->Lock();
+		}
+		_dropped += _ok ? 0 : 1;
+		ConsumeLines(_logs, _block->IsRecord() ? _block->m_record.Size() : (_line.size() + 1), 1);
+	}
+	if (_bLocked)
+	{
+		m_share->DropLocked(_dropped + _longCnt);
+		m_sharePushed = m_share->TailLocked();
+		m_share->NotifyData();
+		m_share->Unlock();
+	}
+	if (_dropped)
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "push shared logs failed, drop count ", _dropped);
+	}
+	if (_longCnt)
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "lines longer than the shared ring allowed (",
+				 GetByteSizeString(m_share->LineByteMax()), ") were dropped, count ", _longCnt);
+	}
+	if (_dropped || _longCnt)
+	{
+		m_dropCnt.fetch_add(1, std::memory_order_release);
+	}
+	return true;
+}
+
+void
+Logger::ShareThread()
+{
+	auto _bStop = false;
+	while (!_bStop)
+	{
+		_bStop = m_bShareStop;
+		if (!m_share->Lock())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds{100});
+			continue;
+		}
+		uint64_t _dropped = 0;
+		if (_bStop || m_share->WaitDataLocked(ShareRing::Deadline(std::chrono::milliseconds{100})))
+		{
+			SafeLock _sl(m_mutex);
+			_dropped = m_share->PopLocked([this](std::string_view _line) { PushLine(_line); });
+			if (!m_queueLog.Empty())
+			{
+				NotifyWriteThread();
+			}
+		}
+		m_share->Unlock();
+		if (_dropped)
+		{
+			FileLog(E_LOG_POS, E_WARN, "logger", "producer processes dropped ", _dropped,
+					" lines, the shared ring was full or the lines were longer than half of it");
+		}
+	}
+}
+
+bool
+Logger::TryTakeOverShare(std::string &_file, size_t &_byte, bool _bExit)
+{
+	if (!IsShareProducer())
+	{
+		return false;
+	}
+	const auto _now = std::chrono::steady_clock::now();
+	if (!_bExit && (_now - m_shareTryTime < std::chrono::milliseconds{200}))
+	{
+		return false;
+	}
+	m_shareTryTime = _now;
+	if (!m_share->TryLockWriter())
+	{
+		return false;
+	}
+	M_StdLog(E_LOG_POS, E_INFO, "took over writing shared logs (", m_strName, ")");
+	ScanLogFiles(); // m_queueFile was only used by the write file thread since now
+	_file = MakeLogFileName();
+	_byte = 0;
+	if (!_bExit)
+	{
+		// checked under m_mutex, StopFileLog took m_ptrShareThread to join in the same lock
+		SafeLock _sl(m_mutex);
+		if (!m_bShareStop)
+		{
+			m_ptrShareThread = std::make_shared<std::thread>(&Logger::ShareThread, this);
+			return true;
+		}
+	}
+	// stopping, no ShareThread was joined any more, move the lines left once here
+	if (m_share->Lock())
+	{
+		SafeLock _sl(m_mutex);
+		(void) m_share->PopLocked([this](std::string_view _line) { PushLine(_line); });
+		_sl.unlock();
+		m_share->Unlock();
+	}
+	return true;
+}
+#endif
+
+void
+Logger::DropLogs(LogQueue &_logs)
+{
+	if (!_logs.Empty())
+	{
+		m_dropCnt.fetch_add(1, std::memory_order_release);
+	}
+	while (!_logs.Empty())
+	{
+		m_writtenBlocks.PushBack(_logs.PopFront());
+	}
+}
+
+size_t
+Logger::NextLines(const LogBlock &_block, size_t _byte, size_t &_cnt) const
+{
+	if (_block.IsRecord())
+	{
+		_cnt = 1;
+		return _block.m_record.Size();
+	}
+	const auto _room = (_byte < m_byteMax) ? (m_byteMax - _byte) : size_t{1};
+	const auto _begin = _block.m_ends.begin() + static_cast<std::ptrdiff_t>(_block.m_writtenCnt);
+	auto _it = std::lower_bound(_begin, _block.m_ends.end(), _block.m_written + _room);
+	_it = (_block.m_ends.end() == _it) ? (_block.m_ends.end() - 1) : _it;
+	_cnt = static_cast<size_t>(_it - _begin) + 1;
+	return *_it - _block.m_written;
+}
+
+void
+Logger::ConsumeLines(LogQueue &_logs, size_t _byte, size_t _cnt)
+{
+	auto _block = _logs.Front();
+	_block->m_written += _byte;
+	_block->m_writtenCnt += _cnt;
+	if (0 == _block->Count())
+	{
+		m_writtenBlocks.PushBack(_logs.PopFront());
+	}
+}
+
+void
+Logger::WaitLogs(SafeLock &_sl)
+{
+	static constexpr auto _maxInterval = std::chrono::seconds{1};
+	const auto _ready = [this]() { return !m_queueLog.Empty() || m_bStop || IsFlushWaiting(); };
+	switch (m_wakeMode)
+	{
+		case Logger::eWakeBusySpin:
+		{
+			_sl.unlock();
+			while (!m_bPending.load(std::memory_order_acquire) && !m_bStop && !IsFlushWaiting())
+			{
+				CpuRelax();
+			}
+			_sl.lock();
+			break;
+		}
+		case Logger::eWakeSpinPark:
+		{
+			static constexpr uint32_t _spinCnt = 1024 * 16;
+			static constexpr uint32_t _yieldCnt = 64;
+			_sl.unlock();
+			uint32_t i = 0;
+			for (; (i < _spinCnt + _yieldCnt) && !m_bPending.load(std::memory_order_acquire) && !m_bStop
+				   && !IsFlushWaiting(); ++i)
+			{
+				if (i < _spinCnt)
+				{
+					// backoff, relax longer as the spin goes on
+					for (uint32_t j = 0, _n = 1u << (i * 5 / _spinCnt); j < _n; ++j)
+					{
+						CpuRelax();
+					}
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+			_sl.lock();
+			if (!_ready())
+			{
+				m_bWriteThreadParked = true;
+				m_cond.wait_for(_sl, _maxInterval, _ready);
+				m_bWriteThreadParked = false;
+			}
+			break;
+		}
+		case Logger::eWakeTimedBatch:
+		{
+			m_cond.wait_for(_sl, m_batchInterval, [this]() { return m_bStop || IsFlushWaiting(); });
+			break;
+		}
+		default:
+		{
+			m_cond.wait_for(_sl, _maxInterval, _ready);
+			break;
+		}
+	}
+}
+
+void
+Logger::CpuRelax()
+{
+#if defined(_MSC_VER)
+	YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#else
+	std::this_thread::yield();
+#endif
+}
+
+void
+Logger::PlaceWriteThread()
+{
+	if (m_writeThreadCpu >= 0)
+	{
+#if defined(_WIN32)
+		auto _ok = (0 != SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << m_writeThreadCpu));
+#elif defined(__linux__)
+		cpu_set_t _set;
+		CPU_ZERO(std::addressof(_set));
+		CPU_SET(m_writeThreadCpu, std::addressof(_set));
+		auto _ok = (0 == sched_setaffinity(0, sizeof(_set), std::addressof(_set))); // 0 is the calling thread
+#else
+		auto _ok = false;
+#endif
+		if (!_ok)
+		{
+			M_StdLog(E_LOG_POS, E_WARN, "pin write file thread to cpu (", m_writeThreadCpu, ") failed");
+		}
+	}
+
+	if (0 != m_writeThreadPriority)
+	{
+#if defined(_WIN32)
+		auto _ok = (0 != SetThreadPriority(GetCurrentThread(), m_writeThreadPriority));
+#elif defined(__linux__)
+		auto _ok = false;
+		if (m_writeThreadPriority > 0)
+		{
+			sched_param _param{};
+			_param.sched_priority = std::min(m_writeThreadPriority, sched_get_priority_max(SCHED_FIFO));
+			_ok = (0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, std::addressof(_param)));
+		}
+		else
+		{
+			// lower than normal as THREAD_PRIORITY_xxx on windows, by the nice value of this thread only
+			_ok = (0 == setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+									std::min(-m_writeThreadPriority, 19)));
+		}
+#else
+		auto _ok = false;
+#endif
+		if (!_ok)
+		{
+			M_StdLog(E_LOG_POS, E_WARN, "set write file thread priority (", m_writeThreadPriority, ") failed");
+		}
+	}
+}
+
+bool
+Logger::WriteFile(LogQueue &_logs, const std::string &_file, size_t &_byte)
+{
+	assert(!_file.empty());
+#ifdef M_HAS_io_uring
+	if (m_bUring)
+	{
+		return WriteFileUring(_logs, _file, _byte);
+	}
+#endif
+	// keep the file open between batches, it was closed while rotating or after errors
+	auto &_ofs = *m_ofs;
+	auto _pos = std::ofstream::pos_type{-1};
+	if (!_ofs.is_open() || (_file != m_ofsFile))
+	{
+		CloseWritingFile();
+		_ofs.open(_file, std::ios_base::app | std::ios_base::out);
+		if (!_ofs.good())
+		{
+			M_StdLog(E_LOG_POS, E_WARN, "open log file (", _file, ") failed");
+			return false;
+		}
+		m_ofsFile = _file;
+
+		_pos = _ofs.tellp();
+		if (std::ofstream::pos_type{-1} != _pos)
+		{
+			_byte = static_cast<size_t>(_pos);
+		}
+	}
+
+	while (!_logs.Empty())
+	{
+		// check IO status
+		if (!_ofs.good())
+		{
+			_ofs.clear(); // try ensure the file IO is always valid
+			_ofs.flush();
+			if (!_ofs.good())
+			{
+				M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
+				return false;
+			}
+		}
+		// write lines of the front block once
+		const auto _block = _logs.Front();
+		size_t _cnt = 0;
+		const auto _n = NextLines(*_block, _byte, _cnt);
+		if (_block->IsRecord())
+		{
+			_ofs << _block->m_record.m_head << _block->m_record.m_payload << _block->m_record.m_tail << '\n';
+		}
+		else
+		{
+			_ofs.write(_block->m_data.get() + _block->m_written, static_cast<std::streamsize>(_n));
+		}
+		// check file size
+		if ((_pos = _ofs.tellp()) == std::ofstream::pos_type{-1})
+		{
+			_ofs.clear();
+			_ofs.flush();
+			if ((_pos = _ofs.tellp()) == std::ofstream::pos_type{-1})
+			{
+				M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
+				return false;
+			}
+		}
+		// check whether was really written, a short write kept the lines and failed, as it would only repeat
+		if (static_cast<size_t>(_pos) < _byte + _n)
+		{
+			_byte = static_cast<size_t>(_pos);
+			M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, short write");
+			return false;
+		}
+		ConsumeLines(_logs, _n, _cnt);
+		_byte = static_cast<size_t>(_pos);
+		if (_byte >= m_byteMax)
+		{
+			break;
+		}
+	}
+
+	_ofs.flush(); // each batch was on disk as before
+	return true;
+}
+
+#ifdef M_HAS_io_uring
+bool
+Logger::WriteFileUring(LogQueue &_logs, const std::string &_file, size_t &_byte)
+{
+	if (m_uring->IsFailed())
+	{
+		return false; // a previous write failed on completion, count it as an error and go on with a new file
+	}
+	if (!m_uring->IsOpen(_file) && !m_uring->Open(_file, _byte))
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "open log file (", _file, ") failed");
+		return false;
+	}
+
+	while (!_logs.Empty())
+	{
+		const auto _block = _logs.Front();
+		size_t _cnt = 0;
+		const auto _n = NextLines(*_block, _byte, _cnt);
+		auto &_pending = _block->m_pending;
+		auto _ok = true;
+		if (_block->IsRecord())
+		{
+			const auto &_record = _block->m_record;
+			// the line was counted once, by the write of its payload
+			_ok = m_uring->Write(_record.m_head.data(), _record.m_head.size(), _pending, 0)
+				  && m_uring->Write(_record.m_payload.data(), _record.m_payload.size(), _pending, 1)
+				  && m_uring->Write(_record.m_tail.data(), _record.m_tail.size(), _pending, 0)
+				  && m_uring->Write("\n", 1, _pending, 0);
+		}
+		else
+		{
+			_ok = m_uring->Write(_block->m_data.get() + _block->m_written, _n, _pending, _cnt);
+		}
+		if (!_ok)
+		{
+			M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
+			return false;
+		}
+		ConsumeLines(_logs, _n, _cnt);
+		_byte += _n;
+		if (_byte >= m_byteMax)
+		{
+			break;
+		}
+	}
+
+	if (m_bUringDataSync && !m_uring->Sync())
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
+		return false;
+	}
+	return true;
+}
+
+void
+Logger::ReportUringFailures()
+{
+	size_t _cnt = 0;
+	if (m_uring->TakeFailure(_cnt))
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "wrote log file errors, drop count ", _cnt);
+		m_dropCnt.fetch_add(1, std::memory_order_release);
+	}
+}
+#endif
+
+void
+Logger::PollWritingFile()
+{
+#ifdef M_HAS_io_uring
+	if (m_bUring)
+	{
+		m_uring->Poll();
+		ReportUringFailures();
+	}
+#endif
+}
+
+void
+Logger::SyncWritingFile()
+{
+#ifdef M_HAS_io_uring
+	if (m_bUring)
+	{
+		(void) m_uring->Wait();
+		ReportUringFailures();
+	}
+#endif
+}
+
+bool
+Logger::IsWritingFileIdle() const
+{
+#ifdef M_HAS_io_uring
+	return !m_bUring || m_uring->IsIdle();
+#else
+	return true;
+#endif
+}
+
+void
+Logger::CloseWritingFile()
+{
+	if (m_ofs->is_open())
+	{
+		m_ofs->close();
+	}
+	m_ofs->clear();
+#ifdef M_HAS_io_uring
+	if (m_bUring)
+	{
+		m_uring->Close();
+		ReportUringFailures();
+	}
+#endif
+}
+
+bool
+Logger::WriteLogs(LogQueue &_logs, std::string &_file, size_t &_byte)
+{
+	auto _ok = WriteFile(_logs, _file, _byte);
+	if (_ok && _logs.Empty() && (_byte < m_byteMax))
+	{
+		return true;
+	}
+
+	if (!_ok)
+	{
+		if (++m_writeErrorCnt > 5)
+		{
+			return false;
+		}
+	}
+	CloseWritingFile();
+
+	if (_byte)
+	{
+		m_queueFile.push_back(_file);
+		RemoveOldLogFiles();
+	}
+	else
+	{
+		M_StdLog(E_LOG_POS, E_INFO, "try remove empty log file (", _file, ")");
+		remove(_file.c_str());
+	}
+	// open new file, the name was made by milliseconds, so wait for a name different from the last file
+	_file = MakeLogFileName();
+	while (!m_queueFile.empty() && (_file == m_queueFile.back()))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		_file = MakeLogFileName();
+	}
+	// append info to last file, structured logs had no such lines for parsing
+	const auto _bMark = (Logger::eFormatText == m_outputFormat);
+	if (_byte && _bMark)
+	{
+		std::ofstream _ofs;
+		_ofs.open(m_queueFile.back(), std::ios_base::app | std::ios_base::out);
+		if (_ofs.good())
+		{
+			_ofs << "**************** See next logs in " << _file << " ****************" << std::endl;
+		}
+	}
+	// append info to current file
+	if (_bMark && !m_queueFile.empty())
+	{
+		auto _block = new LogBlock;
+		_block->m_record.m_head = Format("**************** See previous logs in ", m_queueFile.back(),
+										 " ****************");
+		_logs.PushFront(_block);
+	}
+	// continue write
+	_byte = 0;
+	return WriteLogs(_logs, _file, _byte);
+}
+
+void
+Logger::ScanLogFiles()
+{
+#ifdef M_HAS_share
+	if (IsShareProducer())
+	{
+		return;
+	}
+#endif
+	ListExistLogFiles();
+	RemoveOldLogFiles();
+}
+
+bool
+Logger::IsLogFileName(std::string_view _file, std::string_view _name)
+{
+	static constexpr std::string_view _pattern = "_00000000_000000_000.log"; // '0' for a digit
+	if ((_file.size() != _name.size() + _pattern.size()) || (0 != _file.compare(0, _name.size(), _name)))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < _pattern.size(); ++i)
+	{
+		const auto _c = _file[_name.size() + i];
+		if (('0' == _pattern[i]) ? ((_c < '0') || (_c > '9')) : (_c != _pattern[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+Logger::ListExistLogFiles()
+{
+	m_queueFile.clear();
+	try
+	{
+		std::vector<std::string> _names;
+		for (const auto &item: M_filesystem::directory_iterator{m_strDir})
+		{
+			auto _name = item.path().filename().string();
+			// match the name first, so only log files were checked for the type
+			if (!IsLogFileName(_name, m_strName))
+			{
+				continue;
+			}
+#if defined(M_HAS_std_filesystem)
+			if (item.is_regular_file())
+#elif defined(M_HAS_std_experimental_filesystem)
+			if ((M_filesystem::file_type::regular == item.symlink_status().type()))
+#endif
+			{
+				_names.emplace_back(std::move(_name));
+			}
+		}
+
+		/// \brief the name was created by time, so sort by name equal to sort by file create time
+		std::sort(_names.begin(), _names.end());
+		for (const auto &item: _names)
+		{
+			m_queueFile.emplace_back(std::string{m_strDir}.append(1, E_PATH_SEPARATOR).append(item));
+		}
+	}
+	catch (...)
+	{
+		M_StdLog(E_LOG_POS, E_WARN, "list log files in (", m_strDir, ") exception");
+	}
+}
+
+void
+Logger::RemoveOldLogFiles()
+{
+	if (m_queueFile.size() <= m_cntMax)
+	{
+		return;
+	}
+	const auto _cntReduce = m_queueFile.size() - m_cntMax;
+	for (size_t i = 0; i < _cntReduce; ++i)
+	{
+		const auto &_file = m_queueFile.front();
+		if (remove(_file.c_str()) == 0)
+		{
+			M_StdLog(E_LOG_POS, E_INFO, "remove log file (", _file, ") success");
+		}
+		else
+		{
+			M_StdLog(E_LOG_POS, E_WARN, "remove log file (", _file, ") failed");
+		}
+		m_queueFile.pop_front();
+	}
+}
+
+void
+Logger::PrintStdLog(std::string_view _log, uint32_t _level)
+{
+	if (m_bColorStd)
+	{
+#ifdef _WIN32
+		auto _h = GetStdHandle(STD_OUTPUT_HANDLE);
+		CONSOLE_SCREEN_BUFFER_INFO _old{};
+		GetConsoleScreenBufferInfo(_h, std::addressof(_old));
+		SetConsoleTextAttribute(_h, m_stdColor[_level]);
+		std::cout << _log << '\n';
+		SetConsoleTextAttribute(_h, _old.wAttributes);
+		OutputDebugStringA(std::string{_log}.append("\r\n").c_str());
+#else
+		std::cout << m_stdColor[_level] << _log << "\033[0m" << '\n';
+#endif
+	}
+	else
+	{
+		std::cout << _log << '\n';
+#ifdef _WIN32
+		OutputDebugStringA(std::string{_log}.append("\r\n").c_str());
+#endif
+	}
+}
+
+auto
+Logger::GetTimestampForLogContent() -> char (&)[32]
+{
+	// note, this function would always be used with mutex, so the follow 4 arguments can be static
+	static struct tm _t{};
+	static char _timestamp[32] = {0};
+	static uint64_t _milliSeconds = 0;
+	static time_t _seconds = 0;
+
+	_milliSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	_seconds = static_cast<time_t>(_milliSeconds / uint64_t{1000});
+#ifdef _WIN32
+	localtime_s(std::addressof(_t), std::addressof(_seconds));
+#else
+	localtime_r(std::addressof(_seconds), std::addressof(_t));
+#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+#endif
+	snprintf(_timestamp, E_ByteOf(_timestamp), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+			 _t.tm_year + 1900, _t.tm_mon + 1, _t.tm_mday,
+			 _t.tm_hour, _t.tm_min, _t.tm_sec, static_cast<int32_t>(_milliSeconds % uint64_t{1000}));
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+	return _timestamp;
+}
+
+std::string
+Logger::GetExeFullPath()
+{
+	char _path[1024 + 8] = {0};
+#ifdef _WIN32
+	auto _cnt = GetModuleFileNameA(nullptr, _path, 1024);
+	assert(_cnt > 3); // like c:\\aaa\\bbb\\ccc
+#else
+	auto _cnt = readlink("/proc/self/exe", _path, 1024);
+	assert(_cnt > 1); // like /aaa/bbb/ccc
+#endif
+	return (_cnt > 0) ? std::string(_path, _cnt) : "";
+}
+
+std::string
+Logger::GetExeDir()
+{
+	const auto _path = GetExeFullPath();
+	const auto _pos = _path.rfind(E_PATH_SEPARATOR);
+	assert(std::string::npos != _pos);
+	return (std::string::npos == _pos) ? "" : _path.substr(0, (1 > _pos) ? 1 : _pos);
+}
+
+std::string
+Logger::GetExeName()
+{
+	const auto _path = GetExeFullPath();
+	const auto _pos = _path.rfind(E_PATH_SEPARATOR);
+	assert(std::string::npos != _pos);
+	return (std::string::npos == _pos) ? _path : _path.substr(_pos + 1, _path.size() - _pos - 1);
+}
+
+std::string
+Logger::EnsurePath(const std::string &_path, bool bCreateIfNotExist)
+{
+	auto _exeDir = GetExeDir();
+	if (_path.empty())
+	{
+		return _exeDir;
+	}
+	const auto _dir = ('.' == _path[0]) ? (("/" == _exeDir) ? (_exeDir + _path) : (_exeDir + "/" + _path)) : _path;
+
+	try
+	{
+		const auto _p = M_filesystem::absolute(M_filesystem::path{_dir});
+		if (M_filesystem::is_directory(_p))
+		{
+			return _p.string();
+		}
+		else if (bCreateIfNotExist)
+		{
+			if (M_filesystem::create_directories(_p))
+			{
+				return _p.string();
+			}
+		}
+	}
+	catch (...)
+	{
+	}
+	return _exeDir;
+}
+
+std::string
+Logger::GetByteSizeString(size_t _byte, int32_t _precision)
+{
+	const char *_p;
+	double _d = 1.0 * _byte;
+#define E_BYTE_SCALE  (1024.0)
+	if (_d < E_BYTE_SCALE)
+	{
+		_p = "B";
+	}
+	else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	{
+		_p = "KB";
+	}
+	else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	{
+		_p = "MB";
+	}
+	else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	{
+		_p = "GB";
+	}
+	else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	{
+		_p = "TB";
+	}
+	else
+	{
+		_d /= E_BYTE_SCALE;
+		_p = "PB";
+	}
+#undef E_BYTE_SCALE
+	return Format(std::setprecision(_precision), _d, _p);
+}
+
+char
+(&Logger::GetTimestampForLogFileName())[32]
+{
+	// note, this function would always be used with mutex, so the follow 4 arguments can be static
+	static struct tm _t{};
+	static char _timestamp[32] = {0};
+	static uint64_t _milliSeconds = 0;
+	static time_t _seconds = 0;
+
+	_milliSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	_seconds = static_cast<time_t>(_milliSeconds / uint64_t{1000});
+#ifdef _WIN32
+	localtime_s(std::addressof(_t), std::addressof(_seconds));
+#else
+	localtime_r(std::addressof(_seconds), std::addressof(_t));
+#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+#endif
+	snprintf(_timestamp, E_ByteOf(_timestamp), "%04d%02d%02d_%02d%02d%02d_%03d",
+			 _t.tm_year + 1900, _t.tm_mon + 1, _t.tm_mday,
+			 _t.tm_hour, _t.tm_min, _t.tm_sec, static_cast<int32_t>(_milliSeconds % uint64_t{1000}));
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+	return _timestamp;
+}
+
+TraceScope::~TraceScope() noexcept
+{
+	assert(Current() == this); // scopes should end in the reverse order on the thread created them
+	Current() = m_ptrPrev;
+}
+
+TraceScope *&
+TraceScope::Current()
+{
+	thread_local TraceScope *_ptrCurrent = nullptr;
+	return _ptrCurrent;
+}
+
+std::string_view
+TraceScope::Render(Logger &_logger, uint32_t _format)
+{
+	if (_format == m_format)
+	{
+		return m_rendered;
+	}
+
+	std::stringstream _ss;
+	_ss.setf(std::ios::fixed);
+	_ss.precision(3); // for float and double numbers, as the log lines
+	if (m_trace.empty())
+	{
+		// only the fields
+	}
+	else if (Logger::eFormatJson == _format)
+	{
+		_ss << R"(,"trace":")";
+		WriteEscaped(_ss, m_trace);
+		_ss << '"';
+	}
+	else if (Logger::eFormatLogfmt == _format)
+	{
+		_ss << " trace=";
+		Logger::M_FormatString(_ss, _format, m_trace);
+	}
+	else
+	{
+		_ss << "trace=" << m_trace;
+	}
+	if (m_ptrFields)
+	{
+		m_ptrFields->Render(_logger, _ss, _format);
+	}
+	m_rendered = _ss.str();
+	if ((Logger::eFormatText == _format) && !m_rendered.empty())
+	{
+		if (m_trace.empty())
+		{
+			m_rendered.erase(0, 1); // the leading space of the first field
+		}
+		m_rendered.append(" | ");
+	}
+	m_format = _format;
+	return m_rendered;
+}
+
+}
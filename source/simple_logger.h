@@ -2,41 +2,24 @@
 
 #ifdef _WIN32
 #include <Windows.h>
-#else
-#include <unistd.h>
-#endif
-#ifdef ANDROID
-#include <android/log.h>
-#else
-#include <iostream>
 #endif
 #include <sstream>
-#include <fstream>
-#include <iomanip>
 #include <cassert>
-#include <stdexcept>
-#include <regex>
+#include <string_view>
 #include <list>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <utility>
 #include <atomic>
 #include <thread>
+#include <mutex>
 #include <condition_variable>
 
-#if ((defined(_MSC_VER) && (_MSC_VER > 1900)) || (defined(__GNUC__) && (__GNUC__ >= 8)))
-#include <filesystem>
-#define M_HAS_std_filesystem
-#define M_filesystem  std::filesystem
-#else
-#include <experimental/filesystem>
-#define M_HAS_std_experimental_filesystem
-#define M_filesystem  std::experimental::filesystem
-#endif
-
-#ifdef _WIN32
-#define E_PATH_SEPARATOR  '\\'
-#else
-#define E_PATH_SEPARATOR  '/'
-#endif
-
 #define E_MAYBE_UNUSED    [[maybe_unused]]
 #define E_NODISCARD       [[nodiscard]]
 
@@ -78,6 +61,8 @@
 #define E_FileLog(_trace, _level, ...)  E_loggerInst.FileLog(E_LOG_POS, _level, _trace, __VA_ARGS__)
 #define E_StdLogDiy(_level, ...)        E_loggerInst.StdLogDiy(_level, __VA_ARGS__)
 #define E_FileLogDiy(_level, ...)       E_loggerInst.FileLogDiy(_level, __VA_ARGS__)
+#define E_FileLogRaw(_trace, _level, _payload)  E_loggerInst.FileLogRaw(E_LOG_POS, _level, _trace, _payload)
+#define E_FileLogDiyRaw(_level, _payload)       E_loggerInst.FileLogDiyRaw(_level, _payload)
 
 // useful log methods
 #define E_Debug(_trace, ...)  E_FileLog(_trace, E_DEBUG, __VA_ARGS__)
@@ -89,6 +74,33 @@
 #define E_DiyWarn(...)        E_FileLogDiy(E_WARN, __VA_ARGS__)
 #define E_DiyError(...)       E_FileLogDiy(E_ERROR, __VA_ARGS__)
 
+// pre-formatted payload log methods, pass std::string&& to move it through, or std::string_view to copy it once
+#define E_DebugRaw(_trace, _payload)  E_FileLogRaw(_trace, E_DEBUG, _payload)
+#define E_InfoRaw(_trace, _payload)   E_FileLogRaw(_trace, E_INFO, _payload)
+#define E_WarnRaw(_trace, _payload)   E_FileLogRaw(_trace, E_WARN, _payload)
+#define E_ErrorRaw(_trace, _payload)  E_FileLogRaw(_trace, E_ERROR, _payload)
+
+// "{}" style format string log methods, the format string should be a string literal and was checked while compiling
+#define E_FORMAT_EXPAND(_x)        _x
+#define E_FORMAT_FIRST(_fmt, ...)  _fmt
+#define E_FORMAT_STRING(...) \
+    []() { struct FormatHolder { static constexpr const char *Get() { return E_FORMAT_EXPAND(E_FORMAT_FIRST(__VA_ARGS__, ~)); } }; return FormatHolder{}; }()
+#define E_StdLogF(_trace, _level, ...)   E_loggerInst.StdLogF(E_LOG_POS, _level, _trace, E_FORMAT_STRING(__VA_ARGS__), __VA_ARGS__)
+#define E_FileLogF(_trace, _level, ...)  E_loggerInst.FileLogF(E_LOG_POS, _level, _trace, E_FORMAT_STRING(__VA_ARGS__), __VA_ARGS__)
+
+#define E_DebugF(_trace, ...)  E_FileLogF(_trace, E_DEBUG, __VA_ARGS__)
+#define E_InfoF(_trace, ...)   E_FileLogF(_trace, E_INFO, __VA_ARGS__)
+#define E_WarnF(_trace, ...)   E_FileLogF(_trace, E_WARN, __VA_ARGS__)
+#define E_ErrorF(_trace, ...)  E_FileLogF(_trace, E_ERROR, __VA_ARGS__)
+
+// typed key value field, an argument of E_Info etc., e.g. E_Info(_trace, "login", E_KV("uid", 5), E_KV("ok", true))
+#define E_KV(_key, _value)  Simple::MakeField(_key, _value)
+
+// bind a trace and optional E_KV fields to the calling thread until the end of the block, used by logs with a nullptr trace
+#define E_TRACE_SCOPE_JOIN_HELPER(_a, _b)  _a##_b
+#define E_TRACE_SCOPE_JOIN(_a, _b)         E_TRACE_SCOPE_JOIN_HELPER(_a, _b)
+#define E_TraceScope(...)  Simple::TraceScope E_TRACE_SCOPE_JOIN(_traceScope, __LINE__){__VA_ARGS__}
+
 namespace Simple
 {
 
@@ -106,6 +118,213 @@ char
 #define E_CountOf(_array)  sizeof(*Simple::CountOfHelper(_array))
 #define E_ByteOf(_array)   sizeof(*Simple::ByteOfHelper(_array))
 
+/**
+ * @brief the "{}" format string parsed while compiling, each piece was a literal optionally followed by an argument
+ * @note "{{" and "}}" were literal braces, any other single brace made the format string invalid
+ */
+template <size_t len>
+struct FormatSpec
+{
+	struct Piece
+	{
+		size_t m_offset = 0;
+		size_t m_length = 0;
+		size_t m_argIndex = 0;
+		bool m_bArg = false;
+	};
+
+	Piece m_piece[len + 1] = {};
+	size_t m_pieceCnt = 0;
+	size_t m_argCnt = 0;
+	bool m_bValid = true;
+
+	constexpr
+	void
+	AddPiece(size_t _offset, size_t _length, bool _bArg)
+	{
+		m_piece[m_pieceCnt].m_offset = _offset;
+		m_piece[m_pieceCnt].m_length = _length;
+		m_piece[m_pieceCnt].m_argIndex = m_argCnt;
+		m_piece[m_pieceCnt].m_bArg = _bArg;
+		++m_pieceCnt;
+		if (_bArg)
+		{
+			++m_argCnt;
+		}
+	}
+};
+
+constexpr
+size_t
+FormatLength(const char *_fmt)
+{
+	size_t _len = 0;
+	while ('\0' != _fmt[_len])
+	{
+		++_len;
+	}
+	return _len;
+}
+
+template <size_t len>
+constexpr
+FormatSpec<len>
+ParseFormat(const char *_fmt)
+{
+	FormatSpec<len> _spec{};
+	size_t _begin = 0;
+	for (size_t i = 0; i < len; ++i)
+	{
+		const auto _next = (i + 1 < len) ? _fmt[i + 1] : '\0';
+		if ('{' == _fmt[i])
+		{
+			if (('{' != _next) && ('}' != _next))
+			{
+				_spec.m_bValid = false;
+				break;
+			}
+			// "{{" keeps the first brace as literal, "{}" was an argument
+			_spec.AddPiece(_begin, i - _begin + (('{' == _next) ? 1 : 0), '}' == _next);
+			_begin = ++i + 1;
+		}
+		else if ('}' == _fmt[i])
+		{
+			if ('}' != _next)
+			{
+				_spec.m_bValid = false;
+				break;
+			}
+			_spec.AddPiece(_begin, i - _begin + 1, false);
+			_begin = ++i + 1;
+		}
+	}
+	if (_begin < len)
+	{
+		_spec.AddPiece(_begin, len - _begin, false);
+	}
+	return _spec;
+}
+
+/**
+ * @brief the parsed format string of one call site, the holder type was unique for each E_FORMAT_STRING
+ */
+template <typename Holder>
+struct FormatTraits
+{
+	static constexpr auto s_kLength = FormatLength(Holder::Get());
+	static constexpr auto s_kSpec = ParseFormat<s_kLength>(Holder::Get());
+};
+
+// the write file backends, defined in simple_logger.cpp
+class UringWriter;
+class ShareRing;
+
+/**
+ * @brief growing stream buffer reused for each log line, the memory was kept after Reset
+ */
+class LogStreamBuf final : public std::streambuf
+{
+public:
+	LogStreamBuf()
+	{
+		m_buffer.resize(1024);
+		Reset();
+	}
+
+	inline
+	void
+	Reset() { setp(m_buffer.data(), m_buffer.data() + m_buffer.size()); }
+
+	E_NODISCARD inline
+	size_t
+	Size() const { return static_cast<size_t>(pptr() - pbase()); }
+
+	E_NODISCARD inline
+	std::string_view
+	View() const { return {pbase(), Size()}; }
+
+protected:
+	int_type
+	overflow(int_type _c) override
+	{
+		if (traits_type::eq_int_type(_c, traits_type::eof()))
+		{
+			return traits_type::not_eof(_c);
+		}
+		Reserve(1);
+		*pptr() = traits_type::to_char_type(_c);
+		pbump(1);
+		return _c;
+	}
+
+	std::streamsize
+	xsputn(const char *_s, std::streamsize _n) override
+	{
+		Reserve(static_cast<size_t>(_n));
+		memcpy(pptr(), _s, static_cast<size_t>(_n));
+		pbump(static_cast<int>(_n));
+		return _n;
+	}
+
+private:
+	void
+	Reserve(size_t _byte)
+	{
+		const auto _size = Size();
+		if (_size + _byte <= m_buffer.size())
+		{
+			return;
+		}
+		m_buffer.resize(std::max(m_buffer.size() * 2, _size + _byte));
+		setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+		pbump(static_cast<int>(_size));
+	}
+
+private:
+	std::vector<char> m_buffer;
+};
+
+/**
+ * @brief a key value field of structured logs, made by E_KV, kept the value by reference until the log call returned
+ * @note written as " key=value" in the message of text logs, and as a typed field of json and logfmt logs
+ */
+template <typename T>
+struct LogField
+{
+	const char *m_key;
+	const T &m_value;
+};
+
+template <typename T>
+E_NODISCARD inline
+LogField<T>
+MakeField(const char *_key, const T &_value) { return {_key ? _key : "", _value}; }
+
+template <typename T>
+struct IsLogField : std::false_type {};
+
+template <typename T>
+struct IsLogField<LogField<T>> : std::true_type {};
+
+/**
+ * @note only for streaming a field out of the logger, logs wrote fields as logfmt by Logger::M_FormatTextPiece
+ */
+template <typename T>
+inline
+std::ostream &
+operator<<(std::ostream &_os, const LogField<T> &_field)
+{
+	return _os << ' ' << _field.m_key << '=' << _field.m_value;
+}
+
+/**
+ * @brief write _s escaped as the content of a json string, also used by quoted logfmt values
+ */
+void
+WriteEscaped(std::ostream &_os, std::string_view _s);
+
+class TraceScope;
+
 /**
  * @brief
  * @note singleton class, keep singleton object during whole progress living time
@@ -117,10 +336,135 @@ class __attribute__((visibility("default"), aligned(sizeof(void *)))) Logger fin
 #endif
 {
 private:
+	friend class TraceScope;
+
 	using Mutex = std::mutex;
 	using SafeLock = std::unique_lock<Mutex>;
 	using Condition = std::condition_variable;
-	using LogQueue = std::list<std::string>;
+	/**
+	 * @brief one log line kept as head + payload + tail, for a big raw payload which was moved in
+	 */
+	struct LogRecord
+	{
+		std::string m_head;
+		std::string m_payload;
+		std::string m_tail;
+
+		E_NODISCARD inline
+		size_t
+		Size() const { return m_head.size() + m_payload.size() + m_tail.size() + 1; } // with '\n'
+	};
+
+	/**
+	 * @brief a pooled byte block of '\n' terminated log lines, or a single big record
+	 */
+	struct LogBlock
+	{
+		LogBlock *m_next = nullptr;
+		std::unique_ptr<char[]> m_data; // s_kBlockByte bytes, null for a record block
+		size_t m_used = 0;              // appended byte count
+		size_t m_written = 0;           // written byte count
+		std::vector<uint32_t> m_ends;   // end offset of each line, the capacity was kept while pooled
+		size_t m_writtenCnt = 0;        // written line count
+		uint32_t m_pending = 0;         // submitted but not completed writes of io_uring
+		LogRecord m_record;             // the record of a record block
+
+		E_NODISCARD inline
+		bool
+		IsRecord() const { return !m_data; }
+
+		E_NODISCARD inline
+		size_t
+		Count() const { return (IsRecord() ? 1 : m_ends.size()) - m_writtenCnt; }
+	};
+
+	/**
+	 * @brief intrusive list of blocks, pushing and popping never allocates, owns its blocks
+	 */
+	class LogQueue
+	{
+	public:
+		LogQueue() = default;
+
+		~LogQueue() noexcept
+		{
+			while (!Empty())
+			{
+				delete PopFront();
+			}
+		}
+
+		LogQueue(const LogQueue &) = delete;
+
+		LogQueue &
+		operator=(const LogQueue &) = delete;
+
+		E_NODISCARD inline
+		bool
+		Empty() const { return !m_head; }
+
+		E_NODISCARD inline
+		LogBlock *
+		Front() const { return m_head; }
+
+		E_NODISCARD inline
+		LogBlock *
+		Back() const { return m_tail; }
+
+		inline
+		void
+		PushBack(LogBlock *_block)
+		{
+			_block->m_next = nullptr;
+			(m_tail ? m_tail->m_next : m_head) = _block;
+			m_tail = _block;
+		}
+
+		inline
+		void
+		PushFront(LogBlock *_block)
+		{
+			_block->m_next = m_head;
+			m_head = _block;
+			m_tail = m_tail ? m_tail : _block;
+		}
+
+		inline
+		LogBlock *
+		PopFront()
+		{
+			auto _block = m_head;
+			m_head = _block->m_next;
+			m_tail = m_head ? m_tail : nullptr;
+			_block->m_next = nullptr;
+			return _block;
+		}
+
+		inline
+		void
+		Swap(LogQueue &_other) noexcept
+		{
+			std::swap(m_head, _other.m_head);
+			std::swap(m_tail, _other.m_tail);
+		}
+
+		E_NODISCARD
+		size_t
+		Count() const
+		{
+			size_t _cnt = 0;
+			for (auto _block = m_head; _block; _block = _block->m_next)
+			{
+				_cnt += _block->Count();
+			}
+			return _cnt;
+		}
+
+	private:
+		LogBlock *m_head = nullptr;
+		LogBlock *m_tail = nullptr;
+	};
+
 	using FileQueue = std::list<std::string>;
 	using ThreadPtr = std::shared_ptr<std::thread>;
 
@@ -128,6 +472,23 @@ public:
 	// level
 	enum : uint32_t { eDebug, eInfo, eWarn, eError, eCnt };
 
+	/**
+	 * @brief how the write file thread waits for logs
+	 * @note eWakeNotify: sleep on the condition, each log notifies it
+	 * @note eWakeBusySpin: spin without sleeping, takes a whole core, no log notifies it
+	 * @note eWakeSpinPark: spin, then yield with backoff, then sleep on the condition, logs only notify it while sleeping
+	 * @note eWakeTimedBatch: wake up once every batch interval, no log notifies it
+	 */
+	enum : uint32_t { eWakeNotify, eWakeBusySpin, eWakeSpinPark, eWakeTimedBatch, eWakeCnt };
+
+	/**
+	 * @brief layout of log lines
+	 * @note eFormatText: 2021-01-25 15:30:00.123 [Info] trace=abc | message uid=5
+	 * @note eFormatJson: {"time":"2021-01-25 15:30:00.123","level":"Info","trace":"abc","msg":"message","uid":5}
+	 * @note eFormatLogfmt: time="2021-01-25 15:30:00.123" level=Info trace=abc msg="message" uid=5
+	 */
+	enum : uint32_t { eFormatText, eFormatJson, eFormatLogfmt, eFormatCnt };
+
 	static constexpr auto s_kFileByteDefault = size_t{1024} * 1024 * 5;     // 5MB
 	static constexpr auto s_kFileByteAllowMax = size_t{1024} * 1024 * 1024; // 1GB
 	static constexpr auto s_kFileByteAllowMin = size_t{1024} * 1;           // 1KB
@@ -135,21 +496,20 @@ public:
 	static constexpr auto s_kFileCntAllowMax = size_t{1000};
 	static constexpr auto s_kFileCntAllowMin = size_t{1};
 	static constexpr auto s_kFileStorePathDefault = "./Logs";
+	static constexpr auto s_kBatchIntervalDefault = std::chrono::microseconds{1000}; // 1ms
+	static constexpr auto s_kUringDepthDefault = uint32_t{16};
+	static constexpr auto s_kBlockByte = size_t{1024} * 64;                // 64KB
+	static constexpr auto s_kBlockPoolMax = size_t{64};                    // keep 4MB blocks at most
+	static constexpr auto s_kRecordInlineMax = size_t{1024} * 4;           // bigger raw payloads were moved in
+	static constexpr auto s_kShareByteDefault = size_t{1024} * 1024 * 4;   // 4MB
+	static constexpr auto s_kStopDeadlineDefault = std::chrono::milliseconds{3000};
+	static constexpr auto s_kFlushTimeoutDefault = std::chrono::milliseconds{1000};
 
 	static
 	Logger &
-	Inst()
-	{
-		static Logger _inst;
-		return _inst;
-	}
+	Inst();
 
-	~Logger() noexcept
-	{
-		StopFileLog();
-		delete[] m_stdColor;
-		delete[] m_strLevel;
-	}
+	~Logger() noexcept;
 
 	Logger(const Logger &) = delete;
 
@@ -161,76 +521,92 @@ public:
 #ifdef _WIN32
 	ConfigStd(uint32_t _recordLevel = E_INFO, bool _useColor = true,
 			  const WORD(&_color)[Logger::eCnt] =
-				  {E_STD_COLOR_WHITE, E_STD_COLOR_GREEN, E_STD_COLOR_YELLOW, E_STD_COLOR_RED})
+				  {E_STD_COLOR_WHITE, E_STD_COLOR_GREEN, E_STD_COLOR_YELLOW, E_STD_COLOR_RED});
 #else
 	ConfigStd(uint32_t _recordLevel = E_INFO, bool _useColor = true,
 			  char const *(&_color)[Logger::eCnt] = (char const *[Logger::eCnt])
-				  {E_STD_COLOR_WHITE, E_STD_COLOR_GREEN, E_STD_COLOR_YELLOW, E_STD_COLOR_RED})
-#endif
-	{
-		SafeLock _sl(m_mutex);
-		assert(!m_bLogStd); // should not call twice
-		if (m_bLogStd)
-		{
-			return;
-		}
-		m_bLogStd = true;
-		m_levelStd = (_recordLevel > E_ERROR) ? E_ERROR : _recordLevel;
-		m_bColorStd = _useColor;
-		if (m_bColorStd)
-		{
-#ifdef _WIN32
-			m_stdColor = new WORD[Logger::eCnt]{_color[E_DEBUG], _color[E_INFO], _color[E_WARN], _color[E_ERROR]};
-#else
-			m_stdColor = new char const *[Logger::eCnt];
-			m_stdColor[E_DEBUG] = (nullptr == _color[E_DEBUG]) ? E_STD_COLOR_WHITE : _color[E_DEBUG];
-			m_stdColor[E_INFO] = (nullptr == _color[E_INFO]) ? E_STD_COLOR_GREEN : _color[E_INFO];
-			m_stdColor[E_WARN] = (nullptr == _color[E_WARN]) ? E_STD_COLOR_YELLOW : _color[E_WARN];
-			m_stdColor[E_ERROR] = (nullptr == _color[E_ERROR]) ? E_STD_COLOR_RED : _color[E_ERROR];
+				  {E_STD_COLOR_WHITE, E_STD_COLOR_GREEN, E_STD_COLOR_YELLOW, E_STD_COLOR_RED});
 #endif
-		}
-	}
 
 	E_MAYBE_UNUSED
 	void
 	ConfigFile(uint32_t _recordLevel = E_INFO, const std::string &_storeDirectory = Logger::s_kFileStorePathDefault,
-			   size_t _byteMax = Logger::s_kFileByteDefault, size_t _cntMax = Logger::s_kFileCntDefault)
-	{
-		SafeLock _sl(m_mutex);
-		assert(!m_bLogFile); // should not call twice
-		if (m_bLogFile)
-		{
-			return;
-		}
-		m_levelFile = (_recordLevel > E_ERROR) ? E_ERROR : _recordLevel;
-		m_strDir = EnsurePath(_storeDirectory);
-		m_strName = GetExeName();
-#define E_ENSURE_RANGE(_v, _max, _min)  (((_v) > (_max)) ? (_max) : (((_v) < (_min)) ? (_min) : (_v)))
-		m_byteMax = E_ENSURE_RANGE(_byteMax, Logger::s_kFileByteAllowMax, Logger::s_kFileByteAllowMin);
-		m_cntMax = E_ENSURE_RANGE(_cntMax, Logger::s_kFileCntAllowMax, Logger::s_kFileCntAllowMin);
-#undef E_ENSURE_RANGE
-		M_StdLog(E_LOG_POS, E_INFO, "log files were stored in (", m_strDir, "), prefix (", m_strName,
-				 "), max size (", GetByteSizeString(m_byteMax, 1), "), max count (", m_cntMax, ")");
-		ListExistLogFiles();
-		RemoveOldLogFiles();
-		m_bLogFile = true;
-		m_bStop = false;
-		// start the write file thread
-		m_ptrWriteThread = std::make_shared<std::thread>(&Logger::WriteThread, this);
-		do
-		{
-			std::this_thread::sleep_for(std::chrono::milliseconds{16}); // take a break, wait for thread start
-		} while (!m_bWriteThreadAlive && !m_bStop);
-	}
+			   size_t _byteMax = Logger::s_kFileByteDefault, size_t _cntMax = Logger::s_kFileCntDefault);
 
-	E_MAYBE_UNUSED inline
+	/**
+	 * @brief choose how the write file thread waits for logs, and where it runs
+	 * @note should be called before ConfigFile
+	 * @warning spinning modes with a real time priority starve other threads sharing the cpu, give them a spare core
+	 * @param _batchInterval the sleep interval of eWakeTimedBatch
+	 * @param _cpu pin the write file thread to this cpu, -1 not pinned, also not pinned out of the cpu mask
+	 * @param _priority real time (SCHED_FIFO) priority of the write file thread on linux if positive,
+	 *        a nice value of -_priority if negative, or THREAD_PRIORITY_xxx on windows, 0 not changed
+	 */
+	E_MAYBE_UNUSED
 	void
-	ConfigAlwaysMarkSourceCodePosition()
-	{
-		SafeLock _sl(m_mutex);
-		assert(!m_bAlwaysMarkSourceCodePosition); // should not call twice
-		m_bAlwaysMarkSourceCodePosition = true;
-	}
+	ConfigWriteThread(uint32_t _wakeMode = Logger::eWakeNotify,
+					  std::chrono::microseconds _batchInterval = Logger::s_kBatchIntervalDefault,
+					  int32_t _cpu = -1, int32_t _priority = 0);
+
+	/**
+	 * @brief write log files through io_uring on linux, the queued blocks were submitted as is, _depth writes in flight
+	 * @note should be called before ConfigFile, fall back to std::ofstream when io_uring was not available
+	 * @param _bDataSync submit a fdatasync after each batch of logs
+	 */
+	E_MAYBE_UNUSED
+	void
+	ConfigUring(uint32_t _depth = Logger::s_kUringDepthDefault, bool _bDataSync = false);
+
+	/**
+	 * @brief share one set of log files by processes with the same _key through a shared memory ring
+	 * @note should be called before ConfigFile, the first process locked "/dev/shm/simple_logger_<key>.lock"
+	 *       ("/tmp/" out of Linux) was the writer, whatever its log directory,
+	 *       others pushed their logs into the ring, and took over once the writer exited
+	 * @param _key the log file prefix and the shared memory name, the executable name if empty
+	 * @param _byte the ring size, only used by the process created the shared memory,
+	 *        a line longer than half of it was dropped with a warning, as it never fit
+	 */
+	E_MAYBE_UNUSED
+	void
+	ConfigShare(const std::string &_key = "", size_t _byte = Logger::s_kShareByteDefault);
+
+	/**
+	 * @brief write json lines or logfmt instead of text, the fields of E_KV were typed key values
+	 * @note should be called before ConfigFile, diy logs and the console messages of the logger itself were not changed
+	 */
+	E_MAYBE_UNUSED
+	void
+	ConfigOutputFormat(uint32_t _format = Logger::eFormatJson);
+
+	/**
+	 * @brief list and remove the old log files by the write file thread, so ConfigFile returned without scanning
+	 *        the directory, logs were queued meanwhile
+	 * @note should be called before ConfigFile
+	 */
+	E_MAYBE_UNUSED
+	void
+	ConfigBackgroundRetentionScan();
+
+	/**
+	 * @brief the logs left at stopping were written until _deadline, the rest were dropped
+	 * @note could be called at any time, it was only used by stopping
+	 */
+	E_MAYBE_UNUSED
+	void
+	ConfigStopDeadline(std::chrono::milliseconds _deadline = Logger::s_kStopDeadlineDefault);
+
+	/**
+	 * @brief wait until the logs queued before were written into the log file, that is, handed to the kernel,
+	 *        or pushed into the shared ring by a producer process
+	 * @return false if _timeout passed first, or logs were dropped by write errors since the last Flush
+	 */
+	E_MAYBE_UNUSED
+	bool
+	Flush(std::chrono::milliseconds _timeout = Logger::s_kFlushTimeoutDefault);
+
+	E_MAYBE_UNUSED
+	void
+	ConfigAlwaysMarkSourceCodePosition();
 
 	template <typename ... Tn>
 	E_MAYBE_UNUSED inline
@@ -240,7 +616,9 @@ public:
 		if (m_bLogStd)
 		{
 			SafeLock _sl(m_mutex);
-			PrintStdLog(Format(tn...), _level);
+			auto &_os = BeginLine(false);
+			(M_FormatTextPiece(_os, tn), ...);
+			PrintStdLog(m_streamBuf.View(), _level);
 		}
 	}
 
@@ -254,7 +632,8 @@ public:
 		if (NeedRecordStd(_level))
 		{
 			SafeLock _sl(m_mutex);
-			PrintStdLog(M_Format(_file, _line, _func, _level, _trace, _tn...), _level);
+			M_Format(BeginLine(), _file, _line, _func, _level, _trace, _tn...);
+			PrintStdLog(m_streamBuf.View(), _level);
 		}
 	}
 
@@ -272,21 +651,20 @@ public:
 	void
 	FileLogDiy(uint32_t _level, const Tn &... tn)
 	{
-		if (m_bLogFile && m_bWriteThreadAlive)
+		const auto _bFile = m_bLogFile && m_bWriteThreadAlive;
+		if (_bFile || m_bLogStd)
 		{
 			SafeLock _sl(m_mutex);
-			auto _content = Format(tn...);
-			if (m_bLogStd)
+			auto &_os = BeginLine(false);
+			if (Logger::eFormatText == m_outputFormat)
 			{
-				PrintStdLog(_content, _level);
+				(M_FormatTextPiece(_os, tn), ...);
 			}
-			m_queueLog.emplace_back(std::forward<std::string>(_content));
-			m_cond.notify_one();
-		}
-		else if (m_bLogStd)
-		{
-			SafeLock _sl(m_mutex);
-			PrintStdLog(Format(tn...), _level);
+			else
+			{
+				M_Format(_os, nullptr, 0, nullptr, _level, "", tn...); // a record without trace and position
+			}
+			EndLine(_level, m_bLogStd, _bFile);
 		}
 	}
 
@@ -297,21 +675,12 @@ public:
 			uint32_t _level, const char *__restrict _trace, const Tn &... _tn)
 	{
 		assert(_file && _func);
-		if (NeedRecordFile(_level))
-		{
-			SafeLock _sl(m_mutex);
-			auto strLog = M_Format(_file, _line, _func, _level, _trace, _tn...);
-			if (NeedRecordStd(_level))
-			{
-				PrintStdLog(strLog, _level);
-			}
-			m_queueLog.emplace_back(std::forward<std::string>(strLog));
-			m_cond.notify_one();
-		}
-		else if (NeedRecordStd(_level))
+		const auto _bFile = NeedRecordFile(_level);
+		if (_bFile || NeedRecordStd(_level))
 		{
 			SafeLock _sl(m_mutex);
-			PrintStdLog(M_Format(_file, _line, _func, _level, _trace, _tn...), _level);
+			M_Format(BeginLine(), _file, _line, _func, _level, _trace, _tn...);
+			EndLine(_level, NeedRecordStd(_level), _bFile);
 		}
 	}
 
@@ -324,463 +693,739 @@ public:
 		return FileLog(_file, _line, _func, _level, _trace.c_str(), _tn...);
 	}
 
-	E_NODISCARD inline
-	bool
-	NeedRecordStd(uint32_t _level) const { return m_bLogStd && (_level >= m_levelStd); }
-
-	E_NODISCARD inline
-	bool
-	NeedRecordFile(uint32_t _level) const { return m_bLogFile && m_bWriteThreadAlive && (_level >= m_levelFile); }
-
-	[[maybe_unused, nodiscard]] inline
-	bool
-	NeedRecord(uint32_t _level) const { return NeedRecordStd(_level) || NeedRecordFile(_level); }
-
-private:
-	Logger() noexcept:
-		m_strLevel(new (char const *[Logger::eCnt]){"Debug", "Info", "Warn", "Error"}),
-		m_bAlwaysMarkSourceCodePosition(false),
-		m_bLogStd(false), m_bColorStd(false), m_levelStd(E_INFO), m_stdColor(nullptr),
-		m_bLogFile(false), m_bWriteThreadAlive(false), m_levelFile(E_INFO), m_writeErrorCnt(0),
-		m_byteMax(Logger::s_kFileByteDefault), m_cntMax(Logger::s_kFileCntDefault), m_bStop(false) {}
-
+	/**
+	 * @brief log a pre-formatted payload without streaming it,
+	 *        a big payload was moved through to the writer, a small one was copied into the block
+	 */
+	E_MAYBE_UNUSED inline
 	void
-	StopFileLog()
+	FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			   uint32_t _level, const char *__restrict _trace, std::string &&_payload)
 	{
-		ThreadPtr _t;
-		{
-			SafeLock _sl(m_mutex);
-			m_bLogFile = false;
-			m_bStop = true;
-			m_cond.notify_all();
-			_t.swap(m_ptrWriteThread);
-		}
-
-		if (_t)
-		{
-			m_cond.notify_all();
-			if (_t->joinable())
-			{
-				_t->join();
-			}
-		}
+		M_FileLogRaw(_file, _line, _func, _level, _trace, _payload, std::addressof(_payload));
 	}
 
 	/**
-	 * @example 2021-01-25 15:30:00.123 [Debug] it is a debug information
-	 * @example 2021-01-25 15:30:00.345 [Info] it is a normal information
-	 * @example 2021-01-25 15:30:00.567 [Warn] it is a warning information	[directories/source.cpp, 125, test_logger]
-	 * @example 2021-01-25 15:30:00.789 [Error] it is an error information	[directories/source.cpp, 125, test_logger]
+	 * @brief log a pre-formatted payload without streaming it, the payload was copied once
 	 */
-	template <typename ... Tn>
-	E_NODISCARD
-	std::string
-	M_Format(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
-			 uint32_t _level, const char *__restrict _trace, const Tn &... tn)
+	E_MAYBE_UNUSED inline
+	void
+	FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			   uint32_t _level, const char *__restrict _trace, std::string_view _payload)
 	{
-		assert(_level < Logger::eCnt);
-		std::stringstream _ss;
-		_ss.setf(std::ios::fixed);
-		_ss.precision(3); // for float and double numbers
-		_ss << GetTimestampForLogContent() << " [" << m_strLevel[_level] << "] ";
-		if (_trace && ('\0' != _trace[0]))
-		{
-			_ss << "trace=" << _trace << " | ";
-		}
-		FormatHelper(_ss, tn...);
-		if ((_level > E_INFO) || m_bAlwaysMarkSourceCodePosition)
-		{
-			_ss << "\t[" << _file << ", " << _line << ", " << _func << ']';
-		}
-		return _ss.str();
+		M_FileLogRaw(_file, _line, _func, _level, _trace, _payload, nullptr);
 	}
 
-	template <typename ... Tn>
-	inline
+	E_MAYBE_UNUSED inline
 	void
-	M_StdLog(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
-			 uint32_t _level, const Tn &... tn)
+	FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			   uint32_t _level, const char *__restrict _trace, const char *__restrict _payload)
 	{
-		PrintStdLog(M_Format(_file, _line, _func, _level, "logger", tn...), _level);
+		return FileLogRaw(_file, _line, _func, _level, _trace, std::string_view{_payload ? _payload : ""});
 	}
 
-	E_NODISCARD inline
-	std::string
-	MakeLogFileName()
+	template <typename T>
+	E_MAYBE_UNUSED inline
+	void
+	FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			   uint32_t _level, const std::string &_trace, T &&_payload)
 	{
-		return Format(m_strDir, E_PATH_SEPARATOR, m_strName, '_', GetTimestampForLogFileName(), ".log");
+		return FileLogRaw(_file, _line, _func, _level, _trace.c_str(), std::forward<T>(_payload));
 	}
 
-	E_MAYBE_UNUSED
+	E_MAYBE_UNUSED inline
 	void
-	WriteThread()
+	FileLogDiyRaw(uint32_t _level, std::string &&_payload)
 	{
-		assert(m_bLogFile);
-		m_bWriteThreadAlive = true;
-		static constexpr auto _maxInterval = std::chrono::seconds{1};
-		auto _file = MakeLogFileName();
-		size_t _byte = 0;
-		LogQueue _logs;
-		while (!m_bStop)
-		{
-			{
-				SafeLock _sl(m_mutex);
-				if (m_bStop)
-				{
-					break;
-				}
-				m_cond.wait_for(_sl, _maxInterval);
-				if (!m_queueLog.empty())
-				{
-					std::swap(_logs, m_queueLog); // get all logs in queue
-				}
-			}
+		M_FileLogRaw(nullptr, 0, nullptr, _level, nullptr, _payload, std::addressof(_payload));
+	}
 
-			if (!_logs.empty())
-			{
-				m_writeErrorCnt = 0;
-				if (!WriteLogs(_logs, _file, _byte) || !_logs.empty())
-				{
-					M_StdLog(E_LOG_POS, E_WARN, "wrote log file errors, drop count ", _logs.size());
-					_logs.clear();
-				}
-			}
-		}
+	E_MAYBE_UNUSED inline
+	void
+	FileLogDiyRaw(uint32_t _level, std::string_view _payload)
+	{
+		M_FileLogRaw(nullptr, 0, nullptr, _level, nullptr, _payload, nullptr);
+	}
+
+	E_MAYBE_UNUSED inline
+	void
+	FileLogDiyRaw(uint32_t _level, const char *__restrict _payload)
+	{
+		return FileLogDiyRaw(_level, std::string_view{_payload ? _payload : ""});
+	}
 
-		m_bWriteThreadAlive = false;
-		// write final logs
+	template <typename Holder, typename ... Tn>
+	E_MAYBE_UNUSED inline
+	void
+	StdLogF(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			uint32_t _level, const char *__restrict _trace, Holder, const char *, const Tn &... _tn)
+	{
+		M_CheckFormat<Holder, Tn...>();
+		assert(_file && _func);
+		if (NeedRecordStd(_level))
 		{
 			SafeLock _sl(m_mutex);
-			if (!m_queueLog.empty())
-			{
-				std::swap(_logs, m_queueLog); // get all logs in queue
-			}
+			M_FormatF<Holder>(BeginLine(), _file, _line, _func, _level, _trace, _tn...);
+			PrintStdLog(m_streamBuf.View(), _level);
 		}
+	}
 
-		if (!_logs.empty())
+	template <typename Holder, typename ... Tn>
+	E_MAYBE_UNUSED inline
+	void
+	StdLogF(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			uint32_t _level, const std::string &_trace, Holder _holder, const char *_fmt, const Tn &... _tn)
+	{
+		return StdLogF(_file, _line, _func, _level, _trace.c_str(), _holder, _fmt, _tn...);
+	}
+
+	template <typename Holder, typename ... Tn>
+	E_MAYBE_UNUSED
+	void
+	FileLogF(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			 uint32_t _level, const char *__restrict _trace, Holder, const char *, const Tn &... _tn)
+	{
+		M_CheckFormat<Holder, Tn...>();
+		assert(_file && _func);
+		const auto _bFile = NeedRecordFile(_level);
+		if (_bFile || NeedRecordStd(_level))
 		{
-			m_writeErrorCnt = 0;
-			if (!WriteLogs(_logs, _file, _byte) || !_logs.empty())
-			{
-				M_StdLog(E_LOG_POS, E_WARN, "wrote log file errors, drop count ", _logs.size());
-				_logs.clear();
-			}
+			SafeLock _sl(m_mutex);
+			M_FormatF<Holder>(BeginLine(), _file, _line, _func, _level, _trace, _tn...);
+			EndLine(_level, NeedRecordStd(_level), _bFile);
 		}
 	}
 
-	E_NODISCARD
+	template <typename Holder, typename ... Tn>
+	E_MAYBE_UNUSED inline
+	void
+	FileLogF(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			 uint32_t _level, const std::string &_trace, Holder _holder, const char *_fmt, const Tn &... _tn)
+	{
+		return FileLogF(_file, _line, _func, _level, _trace.c_str(), _holder, _fmt, _tn...);
+	}
+
+	E_NODISCARD inline
+	bool
+	NeedRecordStd(uint32_t _level) const { return m_bLogStd && (_level >= m_levelStd); }
+
+	E_NODISCARD inline
 	bool
-	WriteFile(LogQueue &_logs, const std::string &_file, size_t &_byte)
+	NeedRecordFile(uint32_t _level) const { return m_bLogFile && m_bWriteThreadAlive && (_level >= m_levelFile); }
+
+	[[maybe_unused, nodiscard]] inline
+	bool
+	NeedRecord(uint32_t _level) const { return NeedRecordStd(_level) || NeedRecordFile(_level); }
+
+private:
+	Logger() noexcept;
+	void
+	StopFileLog();
+
+	/**
+	 * @example 2021-01-25 15:30:00.123 [Debug] it is a debug information
+	 * @example 2021-01-25 15:30:00.345 [Info] it is a normal information
+	 * @example 2021-01-25 15:30:00.567 [Warn] it is a warning information	[directories/source.cpp, 125, test_logger]
+	 * @example 2021-01-25 15:30:00.789 [Error] it is an error information	[directories/source.cpp, 125, test_logger]
+	 */
+	template <typename ... Tn>
+	inline
+	void
+	M_Format(std::ostream &_os, const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			 uint32_t _level, const char *__restrict _trace, const Tn &... tn)
 	{
-		assert(!_file.empty());
-		std::ofstream _ofs;
-		_ofs.open(_file, std::ios_base::app | std::ios_base::out);
-		if (!_ofs.good())
+		M_FormatHead(_os, m_outputFormat, _level, _trace);
+		if (Logger::eFormatText == m_outputFormat)
 		{
-			M_StdLog(E_LOG_POS, E_WARN, "open log file (", _file, ") failed");
-			return false;
+			(M_FormatTextPiece(_os, tn), ...);
 		}
-
-		auto _pos = _ofs.tellp();
-		if (std::ofstream::pos_type{-1} != _pos)
+		else
 		{
-			_byte = static_cast<size_t>(_pos);
+			auto &_vs = BeginValue();
+			(FormatMessagePiece(_vs, tn), ...);
+			WriteEscaped(_os, m_valueBuf.View());
 		}
+		M_FormatTail(_os, m_outputFormat, _file, _line, _func, _level, tn...);
+	}
 
-		while (!_logs.empty())
+	/**
+	 * @note always the text layout, only for the console messages of the logger itself
+	 */
+	template <typename ... Tn>
+	E_NODISCARD
+	std::string
+	M_Format(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			 uint32_t _level, const char *__restrict _trace, const Tn &... tn)
+	{
+		std::stringstream _ss;
+		_ss.setf(std::ios::fixed);
+		_ss.precision(3); // for float and double numbers
+		M_FormatHead(_ss, Logger::eFormatText, _level, _trace);
+		FormatHelper(_ss, tn...);
+		M_FormatTail(_ss, Logger::eFormatText, _file, _line, _func, _level);
+		return _ss.str();
+	}
+
+	/**
+	 * @note json and logfmt lines ended with the opening quote of the message
+	 */
+	void
+	M_FormatHead(std::ostream &_os, uint32_t _format, uint32_t _level, const char *__restrict _trace);
+
+	/**
+	 * @param _file nullptr for diy logs, which have no source code position
+	 * @param tn the fields of E_KV were written by json and logfmt, other arguments were ignored
+	 */
+	template <typename ... Tn>
+	inline
+	void
+	M_FormatTail(std::ostream &_os, uint32_t _format, const char *__restrict _file, uint32_t _line,
+				 const char *__restrict _func, uint32_t _level, const Tn &... tn)
+	{
+		const auto _bPosition = _file && ((_level > E_INFO) || m_bAlwaysMarkSourceCodePosition);
+		if (Logger::eFormatText == _format)
 		{
-			// check IO status
-			if (!_ofs.good())
-			{
-				_ofs.clear(); // try ensure the file IO is always valid
-				_ofs.flush();
-				if (!_ofs.good())
-				{
-					M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
-					return false;
-				}
-			}
-			// write log once
-			_ofs << _logs.front() << '\n';
-			// check file size
-			if ((_pos = _ofs.tellp()) == std::ofstream::pos_type{-1})
-			{
-				_ofs.clear();
-				_ofs.flush();
-				if ((_pos = _ofs.tellp()) == std::ofstream::pos_type{-1})
-				{
-					M_StdLog(E_LOG_POS, E_WARN, "write log file (", _file, ") failed, bad IO");
-					return false;
-				}
-			}
-			// check whether was really written
-			if (static_cast<size_t>(_pos) > _byte)
+			if (_bPosition)
 			{
-				_logs.pop_front();
-			}
-			_byte = static_cast<size_t>(_pos);
-			if (_byte >= m_byteMax)
-			{
-				return true;
+				_os << "\t[" << _file << ", " << _line << ", " << _func << ']';
 			}
+			return;
 		}
 
-		return true;
-	}
-
-	E_NODISCARD
-	bool
-	WriteLogs(LogQueue &_logs, std::string &_file, size_t &_byte)
-	{
-		auto _ok = WriteFile(_logs, _file, _byte);
-		if (_ok && _logs.empty() && (_byte < m_byteMax))
+		_os << '"';
+		(M_FormatField(_os, _format, tn), ...);
+		if (_bPosition)
 		{
-			return true;
+			M_FormatField(_os, _format, MakeField("file", _file));
+			M_FormatField(_os, _format, MakeField("line", _line));
+			M_FormatField(_os, _format, MakeField("func", _func));
 		}
-
-		if (!_ok)
+		if (Logger::eFormatJson == _format)
 		{
-			if (++m_writeErrorCnt > 5)
-			{
-				return false;
-			}
+			_os << '}';
 		}
+	}
 
-		if (_byte)
+	/**
+	 * @brief text logs wrote the fields of E_KV as logfmt, so a field read the same in every format
+	 */
+	template <typename T>
+	inline
+	void
+	M_FormatTextPiece(std::ostream &_os, const T &t)
+	{
+		if constexpr (IsLogField<T>::value)
 		{
-			m_queueFile.push_back(_file);
-			RemoveOldLogFiles();
+			M_FormatField(_os, Logger::eFormatLogfmt, t);
 		}
 		else
 		{
-			M_StdLog(E_LOG_POS, E_INFO, "try remove empty log file (", _file, ")");
-			remove(_file.c_str());
+			_os << t;
 		}
-		// open new file
-		_file = MakeLogFileName();
-		// append info to last file
-		if (_byte)
+	}
+
+	/**
+	 * @brief the message of structured logs was made of the arguments except fields
+	 */
+	template <typename T>
+	static inline
+	void
+	FormatMessagePiece(std::ostream &_os, const T &t)
+	{
+		if constexpr (!IsLogField<T>::value)
 		{
-			std::ofstream _ofs;
-			_ofs.open(m_queueFile.back(), std::ios_base::app | std::ios_base::out);
-			if (_ofs.good())
-			{
-				_ofs << "**************** See next logs in " << _file << " ****************" << std::endl;
-			}
+			_os << t;
 		}
-		// append info to current file
-		_logs.push_front(Format("**************** See previous logs in ", m_queueFile.back(), " ****************"));
-		// continue write
-		_byte = 0;
-		return WriteLogs(_logs, _file, _byte);
 	}
 
+	template <typename T>
+	inline
 	void
-	ListExistLogFiles()
+	M_FormatField(std::ostream &_os, uint32_t _format, const T &_field)
 	{
-		m_queueFile.clear();
-		try
+		if constexpr (IsLogField<T>::value)
 		{
-			FileQueue _queue;
-			/// \warning the follow line runs error with gcc 4.8, so gcc 7.5 above was needed
-			std::regex reg{m_strName + R"+(_\d{8}_\d{6}_\d{3}\.log)+"};
-			for (const auto &item: M_filesystem::directory_iterator{m_strDir})
+			if (Logger::eFormatJson == _format)
 			{
-				auto _name = item.path().filename().string();
-#if defined(M_HAS_std_filesystem)
-				if (item.is_regular_file())
-#elif defined(M_HAS_std_experimental_filesystem)
-					if ((M_filesystem::file_type::regular == item.symlink_status().type()))
-#endif
-				{
-					if (std::regex_match(_name, reg))
-					{
-						_queue.emplace_back(_name);
-					}
-				}
+				_os << R"(,")";
+				WriteEscaped(_os, _field.m_key);
+				_os << R"(":)";
 			}
-
-			if (!_queue.empty())
+			else
 			{
-				/// \brief the name was created by time, so sort by name equal to sort by file create time
-				_queue.sort();
-				for (const auto &item: _queue)
-				{
-					m_queueFile.emplace_back(Format(m_strDir, E_PATH_SEPARATOR, item));
-				}
+				_os << ' ';
+				M_FormatKey(_os, _field.m_key);
+				_os << '=';
 			}
-		}
-		catch (...)
-		{
-			M_StdLog(E_LOG_POS, E_WARN, "list log files in (", m_strDir, ") exception");
+			M_FormatValue(_os, _format, _field.m_value);
 		}
 	}
 
+	/**
+	 * @brief numbers and bools were written as is, others were strings
+	 */
+	template <typename T>
 	void
-	RemoveOldLogFiles()
+	M_FormatValue(std::ostream &_os, uint32_t _format, const T &_value)
 	{
-		if (m_queueFile.size() <= m_cntMax)
+		if constexpr (std::is_same<T, bool>::value)
 		{
-			return;
+			_os << (_value ? "true" : "false");
 		}
-		const auto _cntReduce = m_queueFile.size() - m_cntMax;
-		for (size_t i = 0; i < _cntReduce; ++i)
+		else if constexpr (std::is_floating_point<T>::value)
 		{
-			const auto &_file = m_queueFile.front();
-			if (remove(_file.c_str()) == 0)
+			if (std::isfinite(_value))
 			{
-				M_StdLog(E_LOG_POS, E_INFO, "remove log file (", _file, ") success");
+				M_FormatFloat(_os, _value);
 			}
 			else
 			{
-				M_StdLog(E_LOG_POS, E_WARN, "remove log file (", _file, ") failed");
+				_os << ((Logger::eFormatJson == _format) ? "null" : (std::isnan(_value) ? "NaN" : "Inf"));
 			}
-			m_queueFile.pop_front();
 		}
+		else if constexpr (std::is_integral<T>::value && (sizeof(T) > 1))
+		{
+			_os << _value;
+		}
+		else if constexpr (std::is_integral<T>::value && !std::is_same<T, char>::value)
+		{
+			_os << static_cast<int32_t>(_value); // int8_t and uint8_t were numbers
+		}
+		else if constexpr (std::is_pointer<T>::value && std::is_convertible<T, std::string_view>::value)
+		{
+			M_FormatString(_os, _format, _value ? std::string_view{_value} : std::string_view{});
+		}
+		else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+		{
+			M_FormatString(_os, _format, std::string_view{_value});
+		}
+		else
+		{
+			BeginValue() << _value;
+			M_FormatString(_os, _format, m_valueBuf.View());
+		}
+	}
+
+	/**
+	 * @brief a json string, or a logfmt value quoted only when it was empty or had ' ', '=', '"' etc.
+	 */
+	static
+	void
+	M_FormatString(std::ostream &_os, uint32_t _format, std::string_view _s);
+
+	/**
+	 * @brief a logfmt key, which could not be quoted, so ' ', '=', '"' etc. were replaced by '_', "_" if empty
+	 */
+	static
+	void
+	M_FormatKey(std::ostream &_os, std::string_view _key);
+
+	/**
+	 * @brief the shortest digits read back as the same value, not the fixed 3 precision of the text stream
+	 */
+	static
+	void
+	M_FormatFloat(std::ostream &_os, float _value);
+
+	static
+	void
+	M_FormatFloat(std::ostream &_os, double _value);
+
+	static
+	void
+	M_FormatFloat(std::ostream &_os, long double _value);
+
+	template <typename Holder, typename ... Tn>
+	static constexpr
+	void
+	M_CheckFormat()
+	{
+		static_assert(FormatTraits<Holder>::s_kSpec.m_bValid,
+					  "unmatched '{' or '}' in format string, use \"{{\" and \"}}\" for literal braces");
+		static_assert(FormatTraits<Holder>::s_kSpec.m_argCnt == sizeof...(Tn),
+					  "count of \"{}\" in format string mismatched count of arguments");
 	}
 
+	/**
+	 * @brief same layout as M_Format, the message was the format string with each "{}" replaced by an argument
+	 */
+	template <typename Holder, typename ... Tn>
 	inline
 	void
-	PrintStdLog(const std::string &_log, uint32_t _level)
+	M_FormatF(std::ostream &_os, const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			  uint32_t _level, const char *__restrict _trace, const Tn &... tn)
 	{
-		if (m_bColorStd)
+		M_FormatHead(_os, m_outputFormat, _level, _trace);
+		if (Logger::eFormatText == m_outputFormat)
 		{
-#ifdef _WIN32
-			auto _h = GetStdHandle(STD_OUTPUT_HANDLE);
-			CONSOLE_SCREEN_BUFFER_INFO _old{};
-			GetConsoleScreenBufferInfo(_h, std::addressof(_old));
-			SetConsoleTextAttribute(_h, m_stdColor[_level]);
-			std::cout << _log << '\n';
-			SetConsoleTextAttribute(_h, _old.wAttributes);
-			OutputDebugStringA((_log + "\r\n").c_str());
-#else
-			std::cout << m_stdColor[_level] << _log << "\033[0m" << '\n';
-#endif
+			FormatPieces<Holder>(_os, std::forward_as_tuple(tn...),
+								 std::make_index_sequence<FormatTraits<Holder>::s_kSpec.m_pieceCnt>{});
 		}
 		else
 		{
-			std::cout << _log << '\n';
-#ifdef _WIN32
-			OutputDebugStringA((_log + "\r\n").c_str());
-#endif
+			FormatPieces<Holder>(BeginValue(), std::forward_as_tuple(tn...),
+								 std::make_index_sequence<FormatTraits<Holder>::s_kSpec.m_pieceCnt>{});
+			WriteEscaped(_os, m_valueBuf.View());
 		}
+		M_FormatTail(_os, m_outputFormat, _file, _line, _func, _level);
 	}
 
-	template <typename T=size_t>
-	E_NODISCARD
-	std::string
-	GetByteSizeString(T _byte, int32_t _precision = 3)
+	template <typename Holder, typename Tuple, size_t ... pi>
+	static inline
+	void
+	FormatPieces(std::ostream &_os, const Tuple &_args, std::index_sequence<pi...>)
 	{
-		assert(std::is_integral<T>::value);
-		const char *_p;
-		double _d = 1.0 * _byte;
-#define E_BYTE_SCALE  (1024.0)
-		if (_d < E_BYTE_SCALE)
+		(FormatPiece<Holder, pi>(_os, _args), ...);
+	}
+
+	/**
+	 * @brief each piece was unrolled while compiling, so nothing of the format string was parsed at runtime
+	 */
+	template <typename Holder, size_t pi, typename Tuple>
+	static inline
+	void
+	FormatPiece(std::ostream &_os, const Tuple &_args)
+	{
+		constexpr auto _piece = FormatTraits<Holder>::s_kSpec.m_piece[pi];
+		if constexpr (_piece.m_length > 0)
 		{
-			_p = "B";
+			_os.write(Holder::Get() + _piece.m_offset, static_cast<std::streamsize>(_piece.m_length));
 		}
-		else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+		if constexpr (_piece.m_bArg && (_piece.m_argIndex < std::tuple_size<Tuple>::value))
 		{
-			_p = "KB";
+			_os << std::get<_piece.m_argIndex>(_args);
 		}
-		else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	}
+
+	/**
+	 * @brief the head and tail were formatted as M_Format, the payload was kept as is, or escaped for structured logs
+	 * @param _file nullptr for diy logs, which have no head and tail in text, and no trace and position in others
+	 * @param _owned the payload could be moved from, nullptr if it should be copied
+	 */
+	void
+	M_FileLogRaw(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+				 uint32_t _level, const char *__restrict _trace, std::string_view _payload, std::string *_owned);
+
+	/**
+	 * @brief reset the reused stream for a new line, called with m_mutex locked
+	 * @param _bFixed fixed and 3 precision for float and double numbers, as M_Format
+	 */
+	inline
+	std::ostream &
+	BeginLine(bool _bFixed = true)
+	{
+		m_streamBuf.Reset();
+		m_stream.clear();
+		m_stream.flags(_bFixed ? (std::ios::dec | std::ios::skipws | std::ios::fixed)
+							   : (std::ios::dec | std::ios::skipws));
+		m_stream.precision(_bFixed ? 3 : 6);
+		m_stream.fill(' ');
+		return m_stream;
+	}
+
+	/**
+	 * @brief reset the reused value stream of structured logs, called with m_mutex locked
+	 */
+	inline
+	std::ostream &
+	BeginValue()
+	{
+		m_valueBuf.Reset();
+		m_valueStream.clear();
+		m_valueStream.flags(m_stream.flags());
+		m_valueStream.precision(m_stream.precision());
+		return m_valueStream;
+	}
+
+	/**
+	 * @brief print and queue the line formatted in the reused stream, called with m_mutex locked
+	 */
+	inline
+	void
+	EndLine(uint32_t _level, bool _bStd, bool _bFile)
+	{
+		const auto _line = m_streamBuf.View();
+		if (_bStd)
 		{
-			_p = "MB";
+			PrintStdLog(_line, _level);
 		}
-		else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+		if (_bFile)
 		{
-			_p = "GB";
+			PushLine(_line);
+			NotifyWriteThread();
 		}
-		else if ((_d /= E_BYTE_SCALE) < E_BYTE_SCALE)
+	}
+
+	/**
+	 * @brief append a line into the last block of the queue, called with m_mutex locked
+	 * @note no allocation once the block pool was warmed up, except lines bigger than a block
+	 */
+	void
+	PushLine(std::string_view _a, std::string_view _b = {}, std::string_view _c = {})
+	{
+		const auto _byte = _a.size() + _b.size() + _c.size() + 1; // with '\n'
+		if (_byte > Logger::s_kBlockByte)
 		{
-			_p = "TB";
+			auto _block = new LogBlock;
+			_block->m_record.m_head.reserve(_byte - 1);
+			_block->m_record.m_head.append(_a).append(_b).append(_c);
+			m_queueLog.PushBack(_block);
+			return;
 		}
-		else
+
+		auto _block = m_queueLog.Back();
+		if (!_block || _block->IsRecord() || (Logger::s_kBlockByte - _block->m_used < _byte))
 		{
-			_d /= E_BYTE_SCALE;
-			_p = "PB";
+			_block = AcquireBlock();
+			m_queueLog.PushBack(_block);
+		}
+		auto _p = _block->m_data.get() + _block->m_used;
+		for (const auto &_piece: {_a, _b, _c})
+		{
+			if (!_piece.empty()) // the data of a default view was null, not allowed by memcpy
+			{
+				memcpy(_p, _piece.data(), _piece.size());
+				_p += _piece.size();
+			}
 		}
-#undef E_BYTE_SCALE
-		return Format(std::setprecision(_precision), _d, _p);
+		*_p = '\n';
+		_block->m_used += _byte;
+		_block->m_ends.push_back(static_cast<uint32_t>(_block->m_used));
 	}
 
-	E_NODISCARD static
-	char
-	(&GetTimestampForLogFileName())[32]
+	/**
+	 * @brief called with m_mutex locked
+	 */
+	E_NODISCARD
+	LogBlock *
+	AcquireBlock();
+
+	/**
+	 * @brief give back blocks whose writes were all completed to the pool, called with m_mutex locked
+	 */
+	void
+	RecycleBlocks(LogQueue &_blocks);
+
+	template <typename ... Tn>
+	inline
+	void
+	M_StdLog(const char *__restrict _file, uint32_t _line, const char *__restrict _func,
+			 uint32_t _level, const Tn &... tn)
 	{
-		// note, this function would always be used with mutex, so the follow 4 arguments can be static
-		static struct tm _t{};
-		static char _timestamp[32] = {0};
-		static uint64_t _milliSeconds = 0;
-		static time_t _seconds = 0;
+		PrintStdLog(M_Format(_file, _line, _func, _level, "logger", tn...), _level);
+	}
 
-		_milliSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch()).count();
-		_seconds = static_cast<time_t>(_milliSeconds / uint64_t{1000});
-#ifdef _WIN32
-		localtime_s(std::addressof(_t), std::addressof(_seconds));
-#else
-		localtime_r(std::addressof(_seconds), std::addressof(_t));
-#endif
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-#endif
-		snprintf(_timestamp, E_ByteOf(_timestamp), "%04d%02d%02d_%02d%02d%02d_%03d",
-				 _t.tm_year + 1900, _t.tm_mon + 1, _t.tm_mday,
-				 _t.tm_hour, _t.tm_min, _t.tm_sec, static_cast<int32_t>(_milliSeconds % uint64_t{1000}));
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
-#endif
-		return _timestamp;
+	E_NODISCARD
+	std::string
+	MakeLogFileName();
+
+	E_MAYBE_UNUSED
+	void
+	WriteThread();
+
+	/**
+	 * @brief write the logs left at stopping a chunk a time until the stop deadline, the rest were dropped
+	 */
+	void
+	WriteFinalLogs(LogQueue &_logs, std::string &_file, size_t &_byte);
+
+	E_NODISCARD inline
+	bool
+	IsFlushWaiting() const { return m_seqFlush.load(std::memory_order_acquire) > m_seqWritten; }
+
+	/**
+	 * @brief the logs drained at _seq were all written, wake Flush, called by the write file thread with m_mutex locked
+	 */
+	void
+	CompleteFlush(uint64_t _seq);
+
+	/**
+	 * @brief write the drained logs into the log file, or push them into the shared ring by a producer process
+	 */
+	void
+	WriteBatch(LogQueue &_logs, std::string &_file, size_t &_byte);
+
+	E_NODISCARD
+	bool
+	IsShareProducer() const;
+
+	/**
+	 * @brief attach the shared ring and elect the writer, called in ConfigFile
+	 */
+	void
+	OpenShare();
+
+	/**
+	 * @brief push all drained lines into the shared ring, wait at most 1s for room, called by a producer process
+	 * @return false if it took over the writer while waiting for room, the lines left were to write into files
+	 */
+	E_NODISCARD
+	bool
+	ShareLogs(LogQueue &_logs, std::string &_file, size_t &_byte);
+
+	/**
+	 * @brief move lines of producer processes from the shared ring into the queue, run by the writer process
+	 */
+	void
+	ShareThread();
+
+	/**
+	 * @brief a producer process became the writer once the lock file was released, checked every 200ms
+	 * @param _bExit called while exiting, drain the shared ring into the queue instead of starting ShareThread,
+	 *        as it was once StopFileLog set m_bShareStop
+	 */
+	E_NODISCARD
+	bool
+	TryTakeOverShare(std::string &_file, size_t &_byte, bool _bExit = false);
+
+	/**
+	 * @brief move the blocks out of the queue, they were recycled once their pending writes were completed
+	 */
+	void
+	DropLogs(LogQueue &_logs);
+
+	/**
+	 * @brief the byte count of the next lines of the block to write, at least one line,
+	 *        and stop at the first line which makes the file reach m_byteMax
+	 * @param _cnt [out] the line count
+	 */
+	E_NODISCARD
+	size_t
+	NextLines(const LogBlock &_block, size_t _byte, size_t &_cnt) const;
+
+	/**
+	 * @brief mark the lines written, and move the block out of the queue once all of its lines were written
+	 */
+	void
+	ConsumeLines(LogQueue &_logs, size_t _byte, size_t _cnt);
+
+	/**
+	 * @brief called by producers with m_mutex locked
+	 */
+	inline
+	void
+	NotifyWriteThread()
+	{
+		++m_seqQueued;
+		m_bPending.store(true, std::memory_order_release);
+		if ((Logger::eWakeNotify == m_wakeMode) || ((Logger::eWakeSpinPark == m_wakeMode) && m_bWriteThreadParked))
+		{
+			m_cond.notify_one();
+		}
 	}
 
+	/**
+	 * @brief wait for logs as m_wakeMode, m_mutex was locked before and after
+	 */
+	void
+	WaitLogs(SafeLock &_sl);
+
+	static
+	void
+	CpuRelax();
+
+	/**
+	 * @brief pin the write file thread and set its priority, called in the write file thread
+	 */
+	void
+	PlaceWriteThread();
+
+	E_NODISCARD
+	bool
+	WriteFile(LogQueue &_logs, const std::string &_file, size_t &_byte);
+
+	/**
+	 * @brief same as WriteFile, but the logs were only submitted, the file was kept open for the next batch
+	 */
+	E_NODISCARD
+	bool
+	WriteFileUring(LogQueue &_logs, const std::string &_file, size_t &_byte);
+
+	/**
+	 * @brief the logs were consumed once their writes were submitted, so those failed on completion were dropped here
+	 */
+	void
+	ReportUringFailures();
+
+	/**
+	 * @brief collect completed writes of the current log file without waiting
+	 */
+	void
+	PollWritingFile();
+
+	/**
+	 * @brief wait for the writes in flight, std::ofstream was flushed after each batch already
+	 */
+	void
+	SyncWritingFile();
+
+	E_NODISCARD
+	bool
+	IsWritingFileIdle() const;
+
+	/**
+	 * @brief complete all pending writes of the current log file
+	 */
+	void
+	CloseWritingFile();
+
+	E_NODISCARD
+	bool
+	WriteLogs(LogQueue &_logs, std::string &_file, size_t &_byte);
+
+	/**
+	 * @brief list the existing log files and remove the ones over the max count, skipped by shared log producers
+	 */
+	void
+	ScanLogFiles();
+
+	/**
+	 * @brief match "<name>_YYYYMMDD_HHMMSS_mmm.log" made by MakeLogFileName, _name was compared literally
+	 */
+	E_NODISCARD static
+	bool
+	IsLogFileName(std::string_view _file, std::string_view _name);
+
+	void
+	ListExistLogFiles();
+
+	void
+	RemoveOldLogFiles();
+
+	void
+	PrintStdLog(std::string_view _log, uint32_t _level);
+
+	E_NODISCARD
+	std::string
+	GetByteSizeString(size_t _byte, int32_t _precision = 3);
+
+	E_NODISCARD static
+	char
+	(&GetTimestampForLogFileName())[32];
+
 	E_NODISCARD static
 	auto
-	GetTimestampForLogContent() -> char (&)[32]
-	{
-		// note, this function would always be used with mutex, so the follow 4 arguments can be static
-		static struct tm _t{};
-		static char _timestamp[32] = {0};
-		static uint64_t _milliSeconds = 0;
-		static time_t _seconds = 0;
+	GetTimestampForLogContent() -> char (&)[32];
 
-		_milliSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch()).count();
-		_seconds = static_cast<time_t>(_milliSeconds / uint64_t{1000});
-#ifdef _WIN32
-		localtime_s(std::addressof(_t), std::addressof(_seconds));
-#else
-		localtime_r(std::addressof(_seconds), std::addressof(_t));
-#endif
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-#endif
-		snprintf(_timestamp, E_ByteOf(_timestamp), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
-				 _t.tm_year + 1900, _t.tm_mon + 1, _t.tm_mday,
-				 _t.tm_hour, _t.tm_min, _t.tm_sec, static_cast<int32_t>(_milliSeconds % uint64_t{1000}));
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
-#endif
-		return _timestamp;
-	}
+	static inline
+	void
+	FormatHelper(std::ostream &) {}
 
 	template <typename T>
-	inline
+	static inline
 	void
-	FormatHelper(std::stringstream &_ss, const T &t)
+	FormatHelper(std::ostream &_os, const T &t)
 	{
-		_ss << t;
+		_os << t;
 	}
 
 	template <typename T1, typename ...Tn>
-	inline
+	static inline
 	void
-	FormatHelper(std::stringstream &_ss, const T1 &t1, const Tn &...tn)
+	FormatHelper(std::ostream &_os, const T1 &t1, const Tn &...tn)
 	{
-		_ss << t1;
-		FormatHelper(_ss, tn...);
+		_os << t1;
+		FormatHelper(_os, tn...);
 	}
 
 	template <typename ...Args>
@@ -797,75 +1442,24 @@ private:
 		return _ss.str();
 	}
 
-	E_NODISCARD static inline
+	E_NODISCARD static
 	std::string
-	GetExeFullPath()
-	{
-		char _path[1024 + 8] = {0};
-#ifdef _WIN32
-		auto _cnt = GetModuleFileNameA(nullptr, _path, 1024);
-		assert(_cnt > 3); // like c:\\aaa\\bbb\\ccc
-#else
-		auto _cnt = readlink("/proc/self/exe", _path, 1024);
-		assert(_cnt > 1); // like /aaa/bbb/ccc
-#endif
-		return (_cnt > 0) ? std::string(_path, _cnt) : "";
-	}
+	GetExeFullPath();
 
 	/***
 	 * @warning not include the last separator
 	 */
-	E_NODISCARD static inline
+	E_NODISCARD static
 	std::string
-	GetExeDir()
-	{
-		const auto _path = GetExeFullPath();
-		const auto _pos = _path.rfind(E_PATH_SEPARATOR);
-		assert(std::string::npos != _pos);
-		return (std::string::npos == _pos) ? "" : _path.substr(0, (1 > _pos) ? 1 : _pos);
-	}
+	GetExeDir();
 
-	E_NODISCARD static inline
+	E_NODISCARD static
 	std::string
-	GetExeName()
-	{
-		const auto _path = GetExeFullPath();
-		const auto _pos = _path.rfind(E_PATH_SEPARATOR);
-		assert(std::string::npos != _pos);
-		return (std::string::npos == _pos) ? _path : _path.substr(_pos + 1, _path.size() - _pos - 1);
-	}
+	GetExeName();
 
 	static
 	std::string
-	EnsurePath(const std::string &_path, bool bCreateIfNotExist = true)
-	{
-		auto _exeDir = GetExeDir();
-		if (_path.empty())
-		{
-			return _exeDir;
-		}
-		const auto _dir = ('.' == _path[0]) ? (("/" == _exeDir) ? (_exeDir + _path) : (_exeDir + "/" + _path)) : _path;
-
-		try
-		{
-			const auto _p = M_filesystem::absolute(M_filesystem::path{_dir});
-			if (M_filesystem::is_directory(_p))
-			{
-				return _p.string();
-			}
-			else if (bCreateIfNotExist)
-			{
-				if (M_filesystem::create_directories(_p))
-				{
-					return _p.string();
-				}
-			}
-		}
-		catch (...)
-		{
-		}
-		return _exeDir;
-	}
+	EnsurePath(const std::string &_path, bool bCreateIfNotExist = true);
 
 private:
 	char const **m_strLevel;
@@ -887,19 +1481,173 @@ private:
 	bool m_bWriteThreadAlive;
 	uint32_t m_levelFile;
 	uint32_t m_writeErrorCnt;
+	std::atomic<uint32_t> m_dropCnt; // times logs were dropped, by write errors or the stop deadline
+	uint32_t m_dropCntFlush;         // m_dropCnt seen by the last Flush
 	size_t m_byteMax;           // log file max byte size
 	size_t m_cntMax;            // log file max count
 	std::atomic_bool m_bStop;
+	bool m_bScanBackground;     // list and remove old log files in the write file thread
+	std::chrono::milliseconds m_stopDeadline;
+	std::chrono::steady_clock::time_point m_stopTime;  // the logs left were dropped after it
+	uint64_t m_seqQueued;       // increased each time logs were queued
+	uint64_t m_seqWritten;      // m_seqQueued of the logs written, only set by the write file thread
+	std::atomic<uint64_t> m_seqFlush; // the m_seqQueued waited by Flush
 	std::string m_strDir;       // log directory
 	std::string m_strName;      // log file base name
 	LogQueue m_queueLog;        // the log queue wait for writing
+	LogQueue m_poolBlock;       // the free blocks
+	size_t m_poolBlockCnt;
+	LogQueue m_writtenBlocks;   // written by the write file thread, wait for recycling
+	LogStreamBuf m_streamBuf;   // the reused buffer of formatting a line
+	std::ostream m_stream;
+	uint32_t m_outputFormat;
+	LogStreamBuf m_valueBuf;    // the reused buffer of a message or value of structured logs, escaped into the line
+	std::ostream m_valueStream;
 	FileQueue m_queueFile;      // the previous file queue
 	ThreadPtr m_ptrWriteThread; // write file thread
 
+	// write file thread wake up and placement
+	uint32_t m_wakeMode;
+	std::chrono::microseconds m_batchInterval;
+	int32_t m_writeThreadCpu;
+	int32_t m_writeThreadPriority;
+	std::atomic_bool m_bPending;   // logs were queued since the last drain, for spinning without m_mutex
+	bool m_bWriteThreadParked;     // eWakeSpinPark is sleeping on m_cond
+
+	// shared logs of processes
+	bool m_bShare;
+	std::string m_shareKey;
+	size_t m_shareByte;
+	std::unique_ptr<ShareRing> m_share;
+	std::atomic_bool m_bShareStop;
+	ThreadPtr m_ptrShareThread;  // move shared logs into the queue, only in the writer process
+	std::chrono::steady_clock::time_point m_shareTryTime;
+	std::string m_shareLine;     // only used by the write file thread
+	uint64_t m_sharePushed;      // the ring tail after the last push, only used by the write file thread
+
+	std::unique_ptr<std::ofstream> m_ofs; // the writing log file, only used by the write file thread
+	std::string m_ofsFile;
+
+	// io_uring write backend
+	bool m_bUring;
+	bool m_bUringDataSync;
+	std::unique_ptr<UringWriter> m_uring; // only used by the write file thread
+
 	Mutex m_mutex;
 	Condition m_cond;
+	Condition m_condFlush;      // m_seqWritten was increased
+};
+
+/**
+ * @brief bind a trace, and optionally E_KV fields, to the calling thread until the scope ends,
+ *        logs with a nullptr trace carry the innermost scope of their thread instead
+ * @note the trace and fields were rendered once, on the first log of the scope, and copied into each line after
+ * @example E_TraceScope("req-42", E_KV("uid", 5)); E_Info(nullptr, "login"); // trace=req-42 uid=5 | login
+ */
+class TraceScope final
+{
+public:
+	/**
+	 * @param _trace nullptr was taken as empty, as the trace of log methods
+	 */
+	template <typename ... Tn>
+	explicit
+	TraceScope(const char *_trace, const LogField<Tn> &... _fields)
+		: TraceScope(std::string_view{_trace ? _trace : ""}, _fields...) {}
+
+	template <typename ... Tn>
+	explicit
+	TraceScope(std::string_view _trace, const LogField<Tn> &... _fields)
+		: m_trace(_trace), m_format(Logger::eFormatCnt), m_ptrPrev(Current())
+	{
+		if constexpr (sizeof...(Tn) > 0)
+		{
+			m_ptrFields = std::make_unique<FieldsOf<Tn...>>(_fields...);
+		}
+		Current() = this;
+	}
+
+	~TraceScope() noexcept;
+
+	TraceScope(const TraceScope &) = delete;
+
+	TraceScope &
+	operator=(const TraceScope &) = delete;
+
+	/**
+	 * @brief the innermost scope of the calling thread, nullptr without any
+	 */
+	E_NODISCARD static
+	TraceScope *&
+	Current();
+
+	/**
+	 * @brief text: "trace=abc uid=5 | ", json: ,"trace":"abc","uid":5, logfmt: " trace=abc uid=5"
+	 * @note called by the logger with its mutex locked
+	 */
+	std::string_view
+	Render(Logger &_logger, uint32_t _format);
+
+private:
+	struct Fields
+	{
+		virtual ~Fields() = default;
+
+		virtual void
+		Render(Logger &_logger, std::ostream &_os, uint32_t _format) const = 0;
+	};
+
+	/**
+	 * @brief the values were copied, strings were owned, as they were rendered after the caller went on
+	 */
+	template <typename ... Tn>
+	struct FieldsOf final : Fields
+	{
+		template <typename T>
+		using Value = std::conditional_t<std::is_convertible<const T &, std::string_view>::value,
+										 std::string, std::decay_t<T>>;
+
+		std::tuple<std::pair<std::string, Value<Tn>>...> m_fields;
+
+		explicit
+		FieldsOf(const LogField<Tn> &... _fields)
+			: m_fields(std::make_pair(std::string{_fields.m_key}, CopyValue(_fields.m_value))...) {}
+
+		/**
+		 * @note a null string pointer was copied as an empty string
+		 */
+		template <typename T>
+		static
+		Value<T>
+		CopyValue(const T &_value)
+		{
+			if constexpr (std::is_pointer<T>::value && std::is_same<Value<T>, std::string>::value)
+			{
+				return _value ? Value<T>{_value} : Value<T>{};
+			}
+			else
+			{
+				return Value<T>(_value);
+			}
+		}
+
+		void
+		Render(Logger &_logger, std::ostream &_os, uint32_t _format) const override
+		{
+			// text logs wrote fields as logfmt
+			const auto _fieldFormat = (Logger::eFormatText == _format) ? Logger::eFormatLogfmt : _format;
+			std::apply([&_logger, &_os, _fieldFormat](const auto &... _field) {
+				(_logger.M_FormatField(_os, _fieldFormat, MakeField(_field.first.c_str(), _field.second)), ...);
+			}, m_fields);
+		}
+	};
+
+	std::string m_trace;
+	std::unique_ptr<Fields> m_ptrFields;
+	std::string m_rendered;
+	uint32_t m_format;    // m_rendered was in this format, eFormatCnt before the first log
+	TraceScope *m_ptrPrev;
 };
 
 }
 
-#undef E_PATH_SEPARATOR
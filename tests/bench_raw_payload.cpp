@@ -0,0 +1,50 @@
+#include "simple_logger.h"
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+
+/**
+ * @brief compare the producer cost of streaming a large payload with the raw payload methods
+ */
+template <typename Fn>
+static
+double
+MeasureMicroSeconds(size_t _cnt, Fn &&_fn)
+{
+	const auto _begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < _cnt; ++i)
+	{
+		_fn(i);
+	}
+	const auto _end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(_end - _begin).count() / static_cast<double>(_cnt);
+}
+
+int
+main()
+{
+	// about 800MB were logged, into a scratch directory removed at the end and rotated to keep 4 files of 64MB at most
+	const auto _dir = (std::filesystem::temp_directory_path() / "simple_logger_bench_raw_payload").string();
+	E_loggerInst.ConfigFile(E_DEBUG, _dir, size_t{1024} * 1024 * 64, 4);
+
+	static constexpr size_t _kCnt = 200;
+	const auto _trace = "bench_raw_payload";
+	for (size_t _byte: {size_t{64} * 1024, size_t{256} * 1024, size_t{1024} * 1024})
+	{
+		const std::string _payload(_byte, 'x');
+		std::vector<std::string> _payloads(_kCnt, _payload); // prepared before timing, so only the logger is measured
+
+		const auto _stream = MeasureMicroSeconds(_kCnt, [&](size_t) { E_Info(_trace, _payload); });
+		const auto _view = MeasureMicroSeconds(_kCnt, [&](size_t) { E_InfoRaw(_trace, std::string_view{_payload}); });
+		const auto _move = MeasureMicroSeconds(_kCnt, [&](size_t i) { E_InfoRaw(_trace, std::move(_payloads[i])); });
+
+		std::cout << std::setw(5) << (_byte / 1024) << "KB payload, per call: stream " << std::fixed
+				  << std::setprecision(2) << _stream << "us, string_view " << _view << "us, move " << _move << "us"
+				  << std::endl;
+	}
+
+	E_loggerInst.Flush(std::chrono::seconds{60});
+	std::error_code _ec;
+	std::filesystem::remove_all(_dir, _ec);
+}
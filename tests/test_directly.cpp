@@ -32,4 +32,27 @@ main()
 	E_Warn(_trace, "cccccccccccccccccccc");
 	E_Error(_trace, "dddddddddddddddddddd");
 	E_DiyError("+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++");
+
+	std::string _payload = "pre-formatted payload moved through";
+	E_InfoRaw(_trace, std::move(_payload));
+	E_WarnRaw(_trace, std::string_view{"pre-formatted payload copied once"});
+	E_FileLogDiyRaw(E_INFO, "=================================================================");
+
+	E_DebugF(_trace, "format without argument");
+	E_InfoF(_trace, "format {} and {}, {{escaped}}", 1, 2.5);
+	E_WarnF(std::string{_trace}, "format string trace {}", "ccc");
+	E_ErrorF(nullptr, "{}{}{}", 'd', "dd", std::string{"ddd"});
+//	E_InfoF(_trace, "mismatched {} {}", 1); // build error
+
+	E_Info(_trace, "key value fields", E_KV("uid", 5), E_KV("ok", true), E_KV("name", "a \"quoted\" name"));
+	E_Warn(_trace, "key value fields", E_KV("cost", 1.25), E_KV("path", std::string{"/api/v1"}));
+
+	{
+		E_TraceScope(_trace, E_KV("uid", 5));
+		E_Info(nullptr, "trace of the scope");
+		E_Warn("own_trace", "own trace wins");
+	}
+	E_Info(nullptr, "out of the scope");
+
+	E_loggerInst.Flush(); // all above were written into the log file
 }
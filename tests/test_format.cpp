@@ -0,0 +1,200 @@
+#include "simple_logger.h"
+#include <iostream>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <random>
+
+/**
+ * @brief check the json escaping against a naive one on random strings, and read the escaped values back,
+ *        also through json log files, where diy lines should be records too, and doubles read back the same
+ */
+static
+std::string
+NaiveEscape(std::string_view _s)
+{
+	static constexpr char s_kHex[] = "0123456789abcdef";
+	std::string _r;
+	for (const auto _ch: _s)
+	{
+		const auto _c = static_cast<unsigned char>(_ch);
+		if ('"' == _c)
+		{
+			_r += "\\\"";
+		}
+		else if ('\\' == _c)
+		{
+			_r += "\\\\";
+		}
+		else if ('\n' == _c)
+		{
+			_r += "\\n";
+		}
+		else if ('\r' == _c)
+		{
+			_r += "\\r";
+		}
+		else if ('\t' == _c)
+		{
+			_r += "\\t";
+		}
+		else if (_c < 0x20)
+		{
+			_r += {'\\', 'u', '0', '0', s_kHex[_c >> 4], s_kHex[_c & 0xF]};
+		}
+		else
+		{
+			_r += _ch;
+		}
+	}
+	return _r;
+}
+
+/**
+ * @brief the content of a json string up to its closing quote, _pos was moved after the quote
+ */
+static
+bool
+Unescape(std::string_view _s, size_t &_pos, std::string &_out)
+{
+	_out.clear();
+	while (_pos < _s.size())
+	{
+		const auto _c = _s[_pos++];
+		if ('"' == _c)
+		{
+			return true;
+		}
+		if ('\\' != _c)
+		{
+			_out += _c;
+			continue;
+		}
+		if (_pos >= _s.size())
+		{
+			return false;
+		}
+		switch (_s[_pos++])
+		{
+			case '"': _out += '"'; break;
+			case '\\': _out += '\\'; break;
+			case 'n': _out += '\n'; break;
+			case 'r': _out += '\r'; break;
+			case 't': _out += '\t'; break;
+			case 'u':
+				if ((_pos + 4 > _s.size()) || ("00" != _s.substr(_pos, 2)))
+				{
+					return false;
+				}
+				_out += static_cast<char>(std::stoi(std::string{_s.substr(_pos + 2, 2)}, nullptr, 16));
+				_pos += 4;
+				break;
+			default:
+				return false;
+		}
+	}
+	return false;
+}
+
+static
+std::string
+RandomString(std::mt19937 &_rand)
+{
+	static constexpr char s_kSpecial[] = "\"\\\n\r\t\x01\x1f =";
+	std::string _s(_rand() % 64, ' ');
+	for (auto &_c: _s)
+	{
+		const auto _r = _rand() % 8;
+		_c = (0 == _r) ? s_kSpecial[_rand() % (sizeof(s_kSpecial) - 1)]
+						: ((1 == _r) ? static_cast<char>(0x80 + _rand() % 0x80) : static_cast<char>(' ' + _rand() % 95));
+	}
+	return _s;
+}
+
+int
+main()
+{
+	size_t _errorCnt = 0;
+	std::mt19937 _rand(20210125);
+
+	std::ostringstream _os;
+	std::string _back;
+	for (size_t i = 0; i < 200000; ++i)
+	{
+		const auto _s = RandomString(_rand);
+		_os.str("");
+		Simple::WriteEscaped(_os, _s);
+		const auto _escaped = _os.str() + '"';
+		size_t _pos = 0;
+		if ((_escaped.substr(0, _escaped.size() - 1) != NaiveEscape(_s))
+			|| !Unescape(_escaped, _pos, _back) || (_back != _s) || (_pos != _escaped.size()))
+		{
+			++_errorCnt;
+		}
+	}
+	std::cout << "escaping: " << _errorCnt << " errors" << std::endl;
+
+	const auto _dir = (std::filesystem::temp_directory_path() / "simple_logger_test_format").string();
+	std::filesystem::remove_all(_dir);
+	E_loggerInst.ConfigOutputFormat(Simple::Logger::eFormatJson);
+	E_loggerInst.ConfigFile(E_DEBUG, _dir, Simple::Logger::s_kFileByteAllowMax, 1);
+	std::vector<std::string> _values;
+	std::vector<double> _doubles;
+	std::uniform_real_distribution<double> _mantissa(-10.0, 10.0);
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		_values.push_back(RandomString(_rand));
+		E_Info(nullptr, "value", E_KV("v", _values.back()));
+		E_DiyInfo("diy ", _values.back());
+		_doubles.push_back(std::ldexp(_mantissa(_rand), static_cast<int>(_rand() % 2000) - 1000));
+		E_Info(nullptr, "double", E_KV("d", _doubles.back()));
+	}
+	E_loggerInst.Flush();
+
+	static constexpr std::string_view s_kValue = R"(,"v":")";
+	static constexpr std::string_view s_kDiy = R"(,"msg":"diy )";
+	static constexpr std::string_view s_kDouble = R"(,"d":)";
+	size_t _recordCnt = 0;
+	size_t _valueIndex = 0;
+	size_t _diyIndex = 0;
+	size_t _doubleIndex = 0;
+	for (const auto &_entry: std::filesystem::directory_iterator{_dir})
+	{
+		std::ifstream _ifs(_entry.path());
+		std::string _line;
+		while (std::getline(_ifs, _line))
+		{
+			++_recordCnt;
+			if ((0 != _line.rfind(R"({"time":")", 0)) || ('}' != _line.back()))
+			{
+				++_errorCnt;
+				continue;
+			}
+			auto _pos = _line.find(s_kValue);
+			if (std::string::npos != _pos)
+			{
+				_pos += s_kValue.size();
+				_errorCnt += (Unescape(_line, _pos, _back) && (_back == _values.at(_valueIndex++))) ? 0 : 1;
+				continue;
+			}
+			_pos = _line.find(s_kDiy);
+			if (std::string::npos != _pos)
+			{
+				_pos += s_kDiy.size();
+				_errorCnt += (Unescape(_line, _pos, _back) && (_back == _values.at(_diyIndex++))) ? 0 : 1;
+				continue;
+			}
+			_pos = _line.find(s_kDouble);
+			if (std::string::npos != _pos)
+			{
+				_errorCnt += (std::stod(_line.substr(_pos + s_kDouble.size())) == _doubles.at(_doubleIndex++)) ? 0 : 1;
+			}
+		}
+	}
+	std::filesystem::remove_all(_dir);
+	_errorCnt += ((_values.size() == _valueIndex) && (_values.size() == _diyIndex) && (_doubles.size() == _doubleIndex))
+				 ? 0 : 1;
+	std::cout << "json log file: " << _recordCnt << " records, " << _errorCnt << " errors in total" << std::endl;
+	std::cout << (_errorCnt ? "FAILED" : "PASSED") << std::endl;
+	return _errorCnt ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+#include "simple_logger.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @brief log sequence numbered lines from many threads into tiny rotated files,
+ *        then parse the files back and check that no line was lost, duplicated or reordered in its thread,
+ *        also from several producer processes sharing the files written by simple_logd,
+ *        and check that write errors and a zero stop deadline were reported as drops without hanging
+ * @example test_stress [thread count] [lines per thread] [file max byte] [wake mode] [io_uring 0/1] [process count]
+ */
+struct StressConfig
+{
+	size_t m_threadCnt = 8;
+	size_t m_lineCnt = 5000;
+	size_t m_byteMax = 4096;
+	uint32_t m_wakeMode = Simple::Logger::eWakeNotify;
+	bool m_bUring = false;
+	size_t m_processCnt = 4; // producer processes of the shared runs, 0 to skip them
+};
+
+static constexpr auto s_kLineByteMax = size_t{64}; // "2021-01-25 15:30:00.123 [Info] trace=t7 | stress 7 4999" and more
+
+/**
+ * @param _bFlush wait for the logs by Flush, otherwise return at once so the logger stops with the queue full
+ * @param _key push the logs into the shared ring of _key, unless empty
+ * @param _firstThread the number of the first thread in the lines, unique among the processes sharing logs
+ * @param _ready called once the logger was configured, before logging
+ */
+static
+int
+LogStress(const StressConfig &_config, const std::string &_dir, bool _bFlush,
+		  const std::string &_key = "", size_t _firstThread = 0, const std::function<void()> &_ready = nullptr)
+{
+	E_loggerInst.ConfigWriteThread(_config.m_wakeMode);
+	if (_config.m_bUring)
+	{
+		E_loggerInst.ConfigUring();
+	}
+	if (!_key.empty())
+	{
+		E_loggerInst.ConfigShare(_key);
+	}
+	E_loggerInst.ConfigStopDeadline(std::chrono::seconds{60}); // long enough to drain, so a loss was a bug
+	E_loggerInst.ConfigFile(E_DEBUG, _dir, _config.m_byteMax, Simple::Logger::s_kFileCntAllowMax);
+	if (_ready)
+	{
+		_ready();
+	}
+
+	std::atomic_bool _bGo{false};
+	std::vector<std::thread> _threads;
+	for (size_t t = 0; t < _config.m_threadCnt; ++t)
+	{
+		_threads.emplace_back([&_config, &_bGo, t = _firstThread + t]() {
+			E_TraceScope("t" + std::to_string(t));
+			while (!_bGo)
+			{
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < _config.m_lineCnt; ++i)
+			{
+				E_Info(nullptr, "stress ", t, ' ', i);
+			}
+		});
+	}
+
+	const auto _begin = std::chrono::steady_clock::now();
+	_bGo = true;
+	for (auto &_thread: _threads)
+	{
+		_thread.join();
+	}
+	const auto _logged = std::chrono::steady_clock::now();
+	if (!_bFlush)
+	{
+		return 0;
+	}
+	if (!E_loggerInst.Flush(std::chrono::seconds{60}))
+	{
+		std::cout << "flush timed out" << std::endl;
+		return 1;
+	}
+	const auto _flushed = std::chrono::steady_clock::now();
+
+	const auto _total = static_cast<double>(_config.m_threadCnt * _config.m_lineCnt);
+	const auto _second = [](auto _d) { return std::chrono::duration<double>(_d).count(); };
+	std::cout << std::fixed << std::setprecision(0) << "logged " << (_total / _second(_logged - _begin))
+			  << " lines/s, on disk " << (_total / _second(_flushed - _begin)) << " lines/s" << std::endl;
+	return 0;
+}
+
+/**
+ * @brief log files could not grow past half of the file max byte, so each rotated file hit write errors
+ * @return 0 if Flush reported the dropped logs
+ */
+static
+int
+LogWriteErrors(const StressConfig &_config, const std::string &_dir)
+{
+	signal(SIGXFSZ, SIG_IGN); // write fails with EFBIG instead
+	const rlimit _limit{_config.m_byteMax / 2, _config.m_byteMax / 2};
+	setrlimit(RLIMIT_FSIZE, std::addressof(_limit));
+	if (_config.m_bUring)
+	{
+		E_loggerInst.ConfigUring();
+	}
+	E_loggerInst.ConfigFile(E_DEBUG, _dir, _config.m_byteMax, Simple::Logger::s_kFileCntAllowMax);
+	for (size_t i = 0; i < _config.m_lineCnt; ++i)
+	{
+		E_Info(nullptr, "stress 0 ", i);
+	}
+	return E_loggerInst.Flush(std::chrono::seconds{60}) ? 1 : 0;
+}
+
+/**
+ * @brief stop with the queue full and a zero stop deadline, the write file thread was sleeping for its batch
+ */
+static
+int
+LogStopDeadline(const StressConfig &_config, const std::string &_dir)
+{
+	E_loggerInst.ConfigWriteThread(Simple::Logger::eWakeTimedBatch, std::chrono::seconds{10});
+	if (_config.m_bUring)
+	{
+		E_loggerInst.ConfigUring();
+	}
+	E_loggerInst.ConfigStopDeadline(std::chrono::milliseconds{0});
+	E_loggerInst.ConfigFile(E_DEBUG, _dir, _config.m_byteMax, Simple::Logger::s_kFileCntAllowMax);
+	for (size_t i = 0; i < _config.m_lineCnt; ++i)
+	{
+		E_Info(nullptr, "stress 0 ", i);
+	}
+	return 0;
+}
+
+/**
+ * @param _bOrder check the order in each thread too, the order was not kept by a process taking over the writer,
+ *        which wrote its own lines before those it pushed into the shared ring
+ * @return count of errors
+ */
+static
+size_t
+VerifyLogFiles(const StressConfig &_config, const std::vector<std::string> &_dirs, bool _bOrder = true)
+{
+	std::vector<std::filesystem::path> _files;
+	for (const auto &_dir: _dirs)
+	{
+		for (const auto &_entry: std::filesystem::directory_iterator{_dir})
+		{
+			_files.push_back(_entry.path());
+		}
+	}
+	// the names were made by milliseconds, in writing order
+	std::sort(_files.begin(), _files.end(), [](const auto &_a, const auto &_b) { return _a.filename() < _b.filename(); });
+
+	std::vector<std::vector<uint32_t>> _seen(_config.m_threadCnt, std::vector<uint32_t>(_config.m_lineCnt, 0));
+	std::vector<int64_t> _last(_config.m_threadCnt, -1);
+	size_t _disorderCnt = 0;
+	size_t _badCnt = 0;
+	for (const auto &_file: _files)
+	{
+		std::ifstream _ifs(_file);
+		std::string _line;
+		while (std::getline(_ifs, _line))
+		{
+			const auto _pos = _line.find("| stress ");
+			if (std::string::npos == _pos)
+			{
+				continue;
+			}
+			size_t t = 0;
+			size_t i = 0;
+			std::istringstream _iss(_line.substr(_pos + 9));
+			if (!(_iss >> t >> i) || (t >= _config.m_threadCnt) || (i >= _config.m_lineCnt))
+			{
+				++_badCnt;
+				continue;
+			}
+			++_seen[t][i];
+			if (_bOrder && (static_cast<int64_t>(i) <= _last[t]))
+			{
+				++_disorderCnt;
+			}
+			_last[t] = static_cast<int64_t>(i);
+		}
+	}
+
+	size_t _lostCnt = 0;
+	size_t _duplicateCnt = 0;
+	for (const auto &_thread: _seen)
+	{
+		for (const auto _cnt: _thread)
+		{
+			_lostCnt += (0 == _cnt) ? 1 : 0;
+			_duplicateCnt += (_cnt > 1) ? (_cnt - 1) : 0;
+		}
+	}
+	std::cout << _files.size() << " files, lost " << _lostCnt << ", duplicated " << _duplicateCnt
+			  << ", out of order " << _disorderCnt << ", unparsable " << _badCnt << std::endl;
+	return _lostCnt + _duplicateCnt + _disorderCnt + _badCnt;
+}
+
+/**
+ * @return true if the process exited with 0 in _timeout, otherwise it was killed
+ */
+static
+bool
+WaitProcess(pid_t _pid, std::chrono::seconds _timeout = std::chrono::seconds{120})
+{
+	if (_pid <= 0)
+	{
+		return false;
+	}
+	const auto _end = std::chrono::steady_clock::now() + _timeout;
+	auto _status = 0;
+	auto _ret = waitpid(_pid, &_status, WNOHANG);
+	for (; (0 == _ret) && (std::chrono::steady_clock::now() < _end); _ret = waitpid(_pid, &_status, WNOHANG))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	}
+	if (0 == _ret)
+	{
+		std::cout << "process " << _pid << " hung, killed" << std::endl;
+		kill(_pid, SIGKILL);
+		waitpid(_pid, &_status, 0);
+		return false;
+	}
+	return (_ret == _pid) && WIFEXITED(_status) && !WEXITSTATUS(_status);
+}
+
+/**
+ * @brief run _fn in a child process, with its stdout and stderr read into _output
+ * @return true if it returned 0 in _timeout
+ */
+static
+bool
+RunCaptured(const std::function<int()> &_fn, std::chrono::seconds _timeout, std::string &_output)
+{
+	int _pipe[2] = {-1, -1};
+	if (0 != pipe(_pipe))
+	{
+		return false;
+	}
+	const auto _pid = fork();
+	if (0 == _pid)
+	{
+		dup2(_pipe[1], STDOUT_FILENO);
+		dup2(_pipe[1], STDERR_FILENO);
+		close(_pipe[0]);
+		close(_pipe[1]);
+		std::exit(_fn()); // the logger stopped by exit
+	}
+	close(_pipe[1]);
+	const auto _end = std::chrono::steady_clock::now() + _timeout;
+	char _buf[4096];
+	pollfd _poll{_pipe[0], POLLIN, 0};
+	while ((_pid > 0) && (std::chrono::steady_clock::now() < _end))
+	{
+		if (poll(std::addressof(_poll), 1, 100) <= 0)
+		{
+			continue;
+		}
+		const auto _n = read(_pipe[0], _buf, sizeof(_buf));
+		if (_n <= 0)
+		{
+			break; // closed by exiting
+		}
+		_output.append(_buf, static_cast<size_t>(_n));
+	}
+	close(_pipe[0]);
+	const auto _left = std::chrono::duration_cast<std::chrono::seconds>(_end - std::chrono::steady_clock::now());
+	return WaitProcess(_pid, std::max(std::chrono::seconds{1}, _left));
+}
+
+/**
+ * @brief simple_logd writes the files, producer processes in their own directories push their lines to it,
+ *        in the takeover run it exited before the producers began logging, so they took over writing in turn
+ * @return count of errors
+ */
+static
+size_t
+ShareStress(const StressConfig &_config, const std::string &_logd, const std::string &_dir, bool _bTakeOver)
+{
+	const auto _key = "stress" + std::to_string(getpid()) + (_bTakeOver ? "t" : "w");
+	const auto _writerDir = _dir + "/logd";
+	std::filesystem::create_directories(_writerDir);
+	const auto _logdPid = fork();
+	if (0 == _logdPid)
+	{
+		execl(_logd.c_str(), _logd.c_str(), _key.c_str(), _writerDir.c_str(), std::to_string(_config.m_byteMax).c_str(),
+			  std::to_string(Simple::Logger::s_kFileCntAllowMax).c_str(), nullptr);
+		_exit(1);
+	}
+	// simple_logd was the writer once its start line was in a file
+	auto _bStarted = false;
+	for (int i = 0; (i < 1000) && !_bStarted && (_logdPid > 0); ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+		for (const auto &_entry: std::filesystem::directory_iterator{_writerDir})
+		{
+			_bStarted = _bStarted || (_entry.file_size() > 0);
+		}
+	}
+
+	// each producer wrote a byte to _readyPipe once it was a producer, and began logging once _goPipe was closed
+	int _readyPipe[2] = {-1, -1};
+	int _goPipe[2] = {-1, -1};
+	_bStarted = _bStarted && (0 == pipe(_readyPipe)) && (0 == pipe(_goPipe));
+	const auto _ready = [&_readyPipe, &_goPipe]() {
+		close(_goPipe[1]);
+		auto _c = 'r';
+		(void) write(_readyPipe[1], &_c, 1);
+		(void) read(_goPipe[0], &_c, 1);
+	};
+	std::vector<std::string> _dirs{_writerDir};
+	std::vector<pid_t> _pids;
+	for (size_t k = 0; _bStarted && (k < _config.m_processCnt); ++k)
+	{
+		_dirs.push_back(_dir + "/p" + std::to_string(k));
+		std::filesystem::create_directories(_dirs.back());
+		_pids.push_back(fork());
+		if (0 == _pids.back())
+		{
+			// the logger stopped by exit
+			std::exit(LogStress(_config, _dirs.back(), true, _key, k * _config.m_threadCnt, _ready));
+		}
+	}
+	size_t _errorCnt = 0;
+	for (size_t k = 0; k < _pids.size(); ++k)
+	{
+		auto _c = 'r';
+		_errorCnt += (1 == read(_readyPipe[0], &_c, 1)) ? 0 : 1;
+	}
+	if (_bTakeOver && (_logdPid > 0))
+	{
+		kill(_logdPid, SIGTERM);
+		_errorCnt += WaitProcess(_logdPid) ? 0 : 1;
+	}
+	for (const auto _fd: {_readyPipe[0], _readyPipe[1], _goPipe[0], _goPipe[1]})
+	{
+		close(_fd);
+	}
+	for (const auto _pid: _pids)
+	{
+		_errorCnt += WaitProcess(_pid) ? 0 : 1;
+	}
+	if (!_bTakeOver && (_logdPid > 0))
+	{
+		kill(_logdPid, SIGTERM);
+		_errorCnt += WaitProcess(_logdPid) ? 0 : 1;
+	}
+	shm_unlink(("/simple_logger_" + _key).c_str());
+	std::error_code _ec;
+	std::filesystem::remove("/dev/shm/simple_logger_" + _key + ".lock", _ec);
+	if (_errorCnt || !_bStarted)
+	{
+		std::cout << "the logging processes failed" << std::endl;
+		return _errorCnt + 1;
+	}
+
+	auto _config1 = _config;
+	_config1.m_threadCnt = _config.m_threadCnt * _config.m_processCnt;
+	// without takeover, a producer wrote nothing into its own directory, or the lines were lost
+	return VerifyLogFiles(_config1, _bTakeOver ? _dirs : std::vector<std::string>{_writerDir}, !_bTakeOver);
+}
+
+int
+main(int argc, char *argv[])
+{
+	StressConfig _config;
+	_config.m_threadCnt = (argc > 1) ? std::stoul(argv[1]) : _config.m_threadCnt;
+	_config.m_lineCnt = (argc > 2) ? std::stoul(argv[2]) : _config.m_lineCnt;
+	_config.m_byteMax = (argc > 3) ? std::stoul(argv[3]) : _config.m_byteMax;
+	_config.m_wakeMode = (argc > 4) ? static_cast<uint32_t>(std::stoul(argv[4])) : _config.m_wakeMode;
+	_config.m_bUring = (argc > 5) && ('0' != argv[5][0]);
+	_config.m_processCnt = (argc > 6) ? std::stoul(argv[6]) : _config.m_processCnt;
+	if (_config.m_threadCnt * _config.m_lineCnt * s_kLineByteMax
+		> _config.m_byteMax * Simple::Logger::s_kFileCntAllowMax)
+	{
+		std::cout << "too many lines for " << Simple::Logger::s_kFileCntAllowMax
+				  << " files, the oldest would be removed, use less lines or a bigger file max byte" << std::endl;
+		return 1;
+	}
+
+	const auto _root = (std::filesystem::temp_directory_path() / "simple_logger_test_stress").string();
+	size_t _errorCnt = 0;
+	for (const auto _bFlush: {true, false})
+	{
+		std::cout << (_bFlush ? "flush:" : "stop with a full queue:") << std::endl;
+		const auto _dir = _root + (_bFlush ? "/flush" : "/stop");
+		std::filesystem::remove_all(_dir);
+		std::filesystem::create_directories(_dir);
+
+		// each run in its own process, as the logger was a singleton and stopped only while exiting
+		const auto _pid = fork();
+		if (0 == _pid)
+		{
+			return LogStress(_config, _dir, _bFlush);
+		}
+		if (!WaitProcess(_pid))
+		{
+			std::cout << "the logging process failed" << std::endl;
+			++_errorCnt;
+			continue;
+		}
+		_errorCnt += VerifyLogFiles(_config, {_dir});
+	}
+
+	// the same lines from each producer process, in as many files in total
+	auto _shareConfig = _config;
+	_shareConfig.m_byteMax = _config.m_byteMax * _config.m_processCnt;
+	const auto _logd = (std::filesystem::absolute(argv[0]).parent_path() / "simple_logd").string();
+	for (const auto _bTakeOver: {false, true})
+	{
+		if (0 == _config.m_processCnt)
+		{
+			break;
+		}
+		std::cout << (_bTakeOver ? "shared, simple_logd stopped at once:" : "shared through simple_logd:") << std::endl;
+		const auto _dir = _root + (_bTakeOver ? "/takeover" : "/share");
+		std::filesystem::remove_all(_dir);
+		_errorCnt += ShareStress(_shareConfig, _logd, _dir, _bTakeOver);
+	}
+
+	// failures should be reported as drops in time, not hang or pass silently
+	for (const auto _bWriteError: {true, false})
+	{
+		std::cout << (_bWriteError ? "write errors:" : "zero stop deadline:") << std::endl;
+		const auto _dir = _root + (_bWriteError ? "/error" : "/deadline");
+		std::filesystem::remove_all(_dir);
+		std::filesystem::create_directories(_dir);
+		std::string _output;
+		const auto _begin = std::chrono::steady_clock::now();
+		const auto _ok = RunCaptured([&_config, &_dir, _bWriteError]() {
+			return _bWriteError ? LogWriteErrors(_config, _dir) : LogStopDeadline(_config, _dir);
+		}, std::chrono::seconds{_bWriteError ? 60 : 5}, _output);
+		const auto _second = std::chrono::duration<double>(std::chrono::steady_clock::now() - _begin).count();
+		const auto _bReported = (std::string::npos != _output.find(_bWriteError ? "wrote log file errors, drop count"
+																			  : "stop deadline passed, drop count"));
+		std::cout << std::setprecision(3) << "exited in " << _second << "s" << (_ok ? "" : " with errors")
+				  << ", drops " << (_bReported ? "" : "not ") << "warned" << std::endl;
+		_errorCnt += (_ok && _bReported) ? 0 : 1;
+	}
+	std::filesystem::remove_all(_root);
+	std::cout << (_errorCnt ? "FAILED" : "PASSED") << std::endl;
+	return _errorCnt ? 1 : 0;
+}